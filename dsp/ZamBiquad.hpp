@@ -0,0 +1,267 @@
+/*
+ * ZamBiquad cascaded second order sections for zam-plugins
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#ifndef ZAMBIQUAD_HPP_INCLUDED
+#define ZAMBIQUAD_HPP_INCLUDED
+
+#include <cmath>
+#include <stdint.h>
+
+#define BIQUAD_QUIET 1e-10	/* state treated as silent, -200 dB */
+
+/*
+ * Up to NSEC biquads in series on NCH channels, transposed direct form II.
+ *
+ * Coefficients are shared by all channels and stored divided by a0, so a
+ * section costs five multiplies per sample. State is kept per section as
+ * one array across the channels, which makes the inner step of every
+ * section a loop over NCH independent lanes that the compiler vectorizes.
+ *
+ * T is the state and coefficient precision, float or double; audio in
+ * and out is always float. A tiny offset is added at the input so the
+ * state never decays into denormals.
+ */
+
+template <typename T, int NCH, int NSEC>
+class ZamBiquadCascade
+{
+public:
+	ZamBiquadCascade()
+		: nactive(NSEC)
+	{
+		int s;
+		for (s = 0; s < NSEC; s++) {
+			setPassthrough(s);
+			enabled[s] = true;
+			order[s] = s;
+		}
+		reset();
+	}
+
+	void reset()
+	{
+		int s, c;
+		for (s = 0; s < NSEC; s++) {
+			for (c = 0; c < NCH; c++) {
+				s1[s][c] = 0.;
+				s2[s][c] = 0.;
+			}
+		}
+	}
+
+	void reset(int sec)
+	{
+		int c;
+		for (c = 0; c < NCH; c++) {
+			s1[sec][c] = 0.;
+			s2[sec][c] = 0.;
+		}
+	}
+
+	/*
+	 * Sections that are switched off are skipped, not run as a
+	 * passthrough, and keep their place so the others keep their state.
+	 * A switched off section holds zero state, as a passthrough would,
+	 * so switching it back on leaves its state alone.
+	 */
+	void setActive(int sec, bool on)
+	{
+		int s;
+
+		if (enabled[sec] == on)
+			return;
+		enabled[sec] = on;
+		if (!on)
+			reset(sec);
+		nactive = 0;
+		for (s = 0; s < NSEC; s++)
+			if (enabled[s])
+				order[nactive++] = s;
+	}
+
+	/* Only the first n sections are run, all of them by default */
+	void setSections(int n)
+	{
+		int s;
+		for (s = 0; s < NSEC; s++)
+			setActive(s, s < n);
+	}
+
+	int getSections() const
+	{
+		return nactive;
+	}
+
+	/*
+	 * True once the state of a section has died away. A flat section can
+	 * then be switched off without dropping the tail it was still ringing.
+	 */
+	bool settled(int sec) const
+	{
+		int c;
+		for (c = 0; c < NCH; c++)
+			if (fabs(s1[sec][c]) >= BIQUAD_QUIET || fabs(s2[sec][c]) >= BIQUAD_QUIET)
+				return false;
+		return true;
+	}
+
+	/* Any a0, the section is normalised here */
+	void setSection(int sec, double b0, double b1, double b2,
+				double a0, double a1, double a2)
+	{
+		double g = 1. / a0;
+
+		b[0][sec] = b0 * g;
+		b[1][sec] = b1 * g;
+		b[2][sec] = b2 * g;
+		a[0][sec] = 1.;
+		a[1][sec] = a1 * g;
+		a[2][sec] = a2 * g;
+	}
+
+	void setPassthrough(int sec)
+	{
+		setSection(sec, 1., 0., 0., 1., 0., 0.);
+	}
+
+	/* Coefficients and active sections of a cascade of any width */
+	template <int NCH2>
+	void copySections(const ZamBiquadCascade<T, NCH2, NSEC>& o)
+	{
+		int s, i;
+		for (s = 0; s < NSEC; s++) {
+			for (i = 0; i < 3; i++) {
+				b[i][s] = o.b[i][s];
+				a[i][s] = o.a[i][s];
+			}
+			if (enabled[s] && !o.enabled[s])
+				reset(s);
+			enabled[s] = o.enabled[s];
+			order[s] = o.order[s];
+		}
+		nactive = o.nactive;
+	}
+
+	/* RBJ cookbook lowpass */
+	void setLowpass(int sec, double fc, double srate, double q)
+	{
+		double w0 = 2. * M_PI * fc / srate;
+		double cw = cos(w0);
+		double alpha = sin(w0) / (2. * q);
+
+		setSection(sec, (1. - cw) / 2., 1. - cw, (1. - cw) / 2.,
+				1. + alpha, -2. * cw, 1. - alpha);
+	}
+
+	/* RBJ cookbook highpass */
+	void setHighpass(int sec, double fc, double srate, double q)
+	{
+		double w0 = 2. * M_PI * fc / srate;
+		double cw = cos(w0);
+		double alpha = sin(w0) / (2. * q);
+
+		setSection(sec, (1. + cw) / 2., -(1. + cw), (1. + cw) / 2.,
+				1. + alpha, -2. * cw, 1. - alpha);
+	}
+
+	/* RBJ cookbook notch */
+	void setNotch(int sec, double fc, double srate, double q)
+	{
+		double w0 = 2. * M_PI * fc / srate;
+		double cw = cos(w0);
+		double alpha = sin(w0) / (2. * q);
+
+		setSection(sec, 1., -2. * cw, 1.,
+				1. + alpha, -2. * cw, 1. - alpha);
+	}
+
+	/* One frame, x[c] in and out for every channel */
+	void tick(T *x)
+	{
+		int k, s, c;
+		for (k = 0; k < nactive; k++) {
+			s = order[k];
+			const T b0 = b[0][s], b1 = b[1][s], b2 = b[2][s];
+			const T a1 = a[1][s], a2 = a[2][s];
+			T *z1 = s1[s];
+			T *z2 = s2[s];
+			for (c = 0; c < NCH; c++) {
+				T in = x[c] + (T)1e-20;
+				T out = b0 * in + z1[c];
+				z1[c] = b1 * in - a1 * out + z2[c];
+				z2[c] = b2 * in - a2 * out;
+				x[c] = out;
+			}
+		}
+	}
+
+	/* One sample of a single channel cascade */
+	T tick(T in)
+	{
+		static_assert(NCH == 1, "tick(T) is for mono cascades");
+		tick(&in);
+		return in;
+	}
+
+	/* A block of planar audio, in place is fine */
+	void process(const float * const *in, float * const *out, uint32_t frames)
+	{
+		T x[NCH];
+		uint32_t i;
+		int c;
+
+		for (i = 0; i < frames; i++) {
+			for (c = 0; c < NCH; c++)
+				x[c] = in[c][i];
+			tick(x);
+			for (c = 0; c < NCH; c++)
+				out[c][i] = (float)x[c];
+		}
+	}
+
+	/* Magnitude response of the active sections at w radians per sample */
+	double magnitude(double w) const
+	{
+		double c1 = cos(w), c2 = cos(2. * w);
+		double si1 = sin(w), si2 = sin(2. * w);
+		double mag = 1.;
+		int k, s;
+		for (k = 0; k < nactive; k++) {
+			s = order[k];
+			double nr = b[0][s] + b[1][s] * c1 + b[2][s] * c2;
+			double ni = -b[1][s] * si1 - b[2][s] * si2;
+			double dr = 1. + a[1][s] * c1 + a[2][s] * c2;
+			double di = -a[1][s] * si1 - a[2][s] * si2;
+			mag *= sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+		}
+		return mag;
+	}
+
+private:
+	template <typename, int, int> friend class ZamBiquadCascade;
+
+	bool enabled[NSEC];
+	int order[NSEC];
+	int nactive;
+
+	T b[3][NSEC];
+	T a[3][NSEC];
+	T s1[NSEC][NCH];
+	T s2[NSEC][NCH];
+};
+
+#endif
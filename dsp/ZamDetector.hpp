@@ -0,0 +1,192 @@
+/*
+ * ZamDetector level detectors for zam-plugins dynamics
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#ifndef ZAMDETECTOR_HPP_INCLUDED
+#define ZAMDETECTOR_HPP_INCLUDED
+
+#include <cmath>
+#include <stdint.h>
+#include "ZamSlidingMax.hpp"
+
+#define DETECT_MAXWIN 4096	/* power of two, a 10 ms window up to 384 kHz */
+#define TP_PHASES 4
+#define TP_TAPS 12		/* taps per phase, 48 tap 4x interpolator */
+#define TP_DELAY (TP_TAPS / 2)	/* whole samples covering its group delay */
+
+/*
+ * Level detector with O(1) cost per sample regardless of window length:
+ *
+ * DETECT_PEAK     sliding maximum of |x| over the window (monotonic deque)
+ * DETECT_RMS      running sum of x^2 over the window, re-summed once per
+ *                 window to stop rounding drift
+ * DETECT_TRUEPEAK sliding maximum of the 4x oversampled |x| (ITU-R BS.1770)
+ *
+ * A window of 1 sample makes peak modes instantaneous.
+ */
+
+class ZamDetector
+{
+public:
+	enum Mode
+	{
+		DETECT_PEAK = 0,
+		DETECT_RMS,
+		DETECT_TRUEPEAK,
+		DETECT_COUNT
+	};
+
+	ZamDetector()
+		: mode(DETECT_PEAK),
+		  window(1)
+	{
+		peak.setWindow(1);
+		int i, p;
+		for (p = 0; p < TP_PHASES; p++) {
+			double dc = 0.;
+			for (i = 0; i < TP_TAPS; i++) {
+				int n = i * TP_PHASES + p;
+				double t = (n - (TP_PHASES * TP_TAPS - 1) / 2.) / TP_PHASES;
+				double w = 0.5 - 0.5 * cos(2. * M_PI * (n + 0.5) / (TP_PHASES * TP_TAPS));
+				double h = (t == 0.) ? 1. : sin(M_PI * t) / (M_PI * t);
+				tpcoeff[p][i] = h * w;
+				dc += h * w;
+			}
+			for (i = 0; i < TP_TAPS; i++)
+				tpcoeff[p][i] /= dc;
+		}
+		reset();
+	}
+
+	void reset()
+	{
+		int i;
+		for (i = 0; i < DETECT_MAXWIN; i++) {
+			sqbuf[i] = 0.f;
+		}
+		for (i = 0; i < 2 * TP_TAPS; i++) {
+			tphist[i] = 0.f;
+		}
+		sum = 0.;
+		pos = 0;
+		tppos = 0;
+		peak.reset();
+	}
+
+	/* Both setters are cheap when nothing changed, call them once per block */
+	void setMode(int m)
+	{
+		if (m < DETECT_PEAK || m >= DETECT_COUNT)
+			m = DETECT_PEAK;
+		if (m == mode)
+			return;
+		mode = m;
+		reset();
+	}
+
+	/* Windows longer than DETECT_MAXWIN samples are clamped to it */
+	void setWindow(uint32_t n)
+	{
+		if (n < 1)
+			n = 1;
+		if (n > DETECT_MAXWIN)
+			n = DETECT_MAXWIN;
+		if (n == window)
+			return;
+		window = n;
+		peak.setWindow(n);
+		reset();
+	}
+
+	int getMode() const
+	{
+		return mode;
+	}
+
+	/* Returns the detected linear level (>= 0) after pushing one sample */
+	float process(float in)
+	{
+		switch (mode) {
+		case DETECT_RMS:
+			return rms(in);
+		case DETECT_TRUEPEAK:
+			return slidingmax(truepeak(in));
+		default:
+			return slidingmax(fabsf(in));
+		}
+	}
+
+private:
+	float rms(float in)
+	{
+		float sq = in * in;
+		sum += sq - sqbuf[pos];
+		sqbuf[pos] = sq;
+		if (++pos >= window) {
+			uint32_t i;
+			pos = 0;
+			sum = 0.;
+			for (i = 0; i < window; i++)
+				sum += sqbuf[i];
+		}
+		return (sum > 0.) ? sqrtf(sum / window) : 0.f;
+	}
+
+	float slidingmax(float v)
+	{
+		if (window == 1)
+			return v;
+
+		peak.push(v);
+		return peak.max();
+	}
+
+	/* History is stored twice so each phase is one contiguous dot product */
+	float truepeak(float in)
+	{
+		float tp = 0.f;
+		int p, i;
+
+		if (tppos == 0)
+			tppos = TP_TAPS;
+		tppos--;
+		tphist[tppos] = tphist[tppos + TP_TAPS] = in;
+
+		const float *x = &tphist[tppos];
+		for (p = 0; p < TP_PHASES; p++) {
+			float y = 0.f;
+			for (i = 0; i < TP_TAPS; i++)
+				y += tpcoeff[p][i] * x[i];
+			tp = fmaxf(tp, fabsf(y));
+		}
+		return tp;
+	}
+
+	int mode;
+	uint32_t window;
+
+	float sqbuf[DETECT_MAXWIN];
+	double sum;
+	uint32_t pos;
+
+	ZamSlidingMax<float, DETECT_MAXWIN> peak;
+
+	float tpcoeff[TP_PHASES][TP_TAPS];
+	float tphist[2 * TP_TAPS];
+	int tppos;
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * ZamEnvTable one-pole envelope coefficient table for zam-plugins
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#ifndef ZAMENVTABLE_HPP_INCLUDED
+#define ZAMENVTABLE_HPP_INCLUDED
+
+#include <cmath>
+
+#define ENVTAB_SIZE 1024
+#define ENVTAB_MIN_MS 0.01f
+#define ENVTAB_MAX_MS 100000.f
+
+/*
+ * exp(-1000 / (ms * srate)) sampled on a logarithmic time grid, about 49
+ * points per octave from 10us to 100s. Built once per sample rate, then
+ * each lookup is a log2 and a linear interpolation, so envelopes can take
+ * all their smoothing coefficients from here once per block.
+ */
+
+class ZamEnvTable
+{
+public:
+	ZamEnvTable()
+		: srate(0.f)
+	{
+		scale = ENVTAB_SIZE / log2f(ENVTAB_MAX_MS / ENVTAB_MIN_MS);
+	}
+
+	/* Not realtime safe, call from activate() */
+	void init(float rate)
+	{
+		int i;
+
+		if (rate == srate)
+			return;
+		srate = rate;
+		for (i = 0; i <= ENVTAB_SIZE; i++) {
+			double ms = ENVTAB_MIN_MS * exp2(i / scale);
+			tab[i] = exp(-1000. / (ms * rate));
+		}
+	}
+
+	/* Smoothing coefficient for a time constant in milliseconds */
+	float coeff(float ms) const
+	{
+		float x;
+		int i;
+
+		if (ms <= ENVTAB_MIN_MS)
+			return tab[0];
+		if (ms >= ENVTAB_MAX_MS)
+			return tab[ENVTAB_SIZE];
+		x = log2f(ms / ENVTAB_MIN_MS) * scale;
+		i = (int)x;
+		if (i >= ENVTAB_SIZE)
+			return tab[ENVTAB_SIZE];
+		return tab[i] + (x - i) * (tab[i+1] - tab[i]);
+	}
+
+private:
+	float srate;
+	float scale;
+	float tab[ENVTAB_SIZE + 1];
+};
+
+#endif
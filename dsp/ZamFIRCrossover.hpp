@@ -0,0 +1,314 @@
+/*
+ * ZamFIRCrossover linear phase multiband splitter for zam-plugins
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#ifndef ZAMFIRCROSSOVER_HPP_INCLUDED
+#define ZAMFIRCROSSOVER_HPP_INCLUDED
+
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "ZamFIRWorker.hpp"
+
+#define XOVER_MAXBANDS 8
+#define XOVER_MAXCHAN 2
+#define XOVER_FRAG 256		/* convolution block, power of two */
+
+/*
+ * Linear phase band splitter. Each band is the difference of two
+ * windowed-sinc lowpass FIRs so the bands sum back to a pure delay.
+ *
+ * All bands of a channel are convolved by one zita-convolver instance,
+ * which transforms each input once and runs one inverse FFT per band.
+ * Input is gathered into XOVER_FRAG blocks so any host buffer size works.
+ *
+ * Filters are designed by a ZamFIRWorker when the crossover settings
+ * change, and a new filter bank only takes over once its history is full
+ * so changes do not drop out. Nothing is designed until the splitter is
+ * first wanted.
+ */
+
+class ZamFIRCrossover
+{
+public:
+	ZamFIRCrossover(int nchannels)
+		: nch(nchannels),
+		  taps(0),
+		  latency(0),
+		  srate(48000.f),
+		  fir(static_design, this, nchannels, XOVER_FRAG)
+	{
+		memset(inbuf, 0, sizeof(inbuf));
+		memset(outbuf, 0, sizeof(outbuf));
+		outbands = 0;
+		pos = 0;
+		filled = 0;
+	}
+
+	~ZamFIRCrossover()
+	{
+		fir.stop();
+	}
+
+	/*
+	 * Not realtime safe, call from activate(): sizes the filters for the
+	 * rate, drops the old bank and starts the worker. The first update()
+	 * designs the bank.
+	 */
+	void init(float rate)
+	{
+		setup(rate);
+		fir.start(taps, NULL);
+	}
+
+	/*
+	 * Not realtime safe, call from activate() when the splitter is in
+	 * use: designs the first filter bank in place and starts the worker.
+	 */
+	void init(float rate, const float *xover, int nbands)
+	{
+		Request r;
+
+		setup(rate);
+		setreq(r, xover, nbands);
+		fir.start(taps, &r);
+		outbands = fir.current() ? r.nbands : 0;
+	}
+
+	/*
+	 * Realtime safe, cheap when nothing changed: call once per block
+	 * while the splitter is wanted. Hands changed settings to the worker.
+	 */
+	void update(const float *xover, int nbands)
+	{
+		Request r;
+
+		setreq(r, xover, nbands);
+		fir.post(r);
+	}
+
+	/* Flush the filter history, for when the splitter was not in use */
+	void reset()
+	{
+		memset(inbuf, 0, sizeof(inbuf));
+		memset(outbuf, 0, sizeof(outbuf));
+		pos = 0;
+		filled = 0;
+		fir.reset();
+	}
+
+	/*
+	 * True once the running bank matches the last update() and has seen
+	 * a full filter length since reset(), so its bands can take over from
+	 * another splitter without playing stale crossovers.
+	 */
+	bool current() const
+	{
+		if (filled <= (uint32_t)taps)
+			return false;
+		return fir.current();
+	}
+
+	uint32_t getLatency() const
+	{
+		return latency;
+	}
+
+	/* Frames until the next block boundary, where getBands() may change */
+	uint32_t getRemaining() const
+	{
+		return XOVER_FRAG - pos;
+	}
+
+	/* Number of bands in the frames currently coming out of process() */
+	int getBands() const
+	{
+		return outbands;
+	}
+
+	/*
+	 * One frame in, one frame of bands out, delayed by getLatency().
+	 * out[c * XOVER_MAXBANDS + b] is band b (lowest first) of channel c.
+	 * With out NULL the splitter is only fed, to fill its history.
+	 */
+	void process(const float *in, float *out)
+	{
+		int c, b;
+
+		for (c = 0; c < nch; c++) {
+			inbuf[c][pos] = in[c];
+			if (out)
+				for (b = 0; b < outbands; b++)
+					out[c * XOVER_MAXBANDS + b] = outbuf[c][b][pos];
+		}
+		if (filled <= (uint32_t)taps)
+			filled++;
+		if (++pos == XOVER_FRAG) {
+			pos = 0;
+			run_fragment();
+		}
+	}
+
+private:
+	struct Request {
+		float srate;
+		int nbands;
+		float xover[XOVER_MAXBANDS - 1];
+	};
+
+	typedef ZamFIRWorker<Request>::Filter Filterbank;
+
+	static int clampbands(int n)
+	{
+		return (n < 1) ? 1 : (n > XOVER_MAXBANDS) ? XOVER_MAXBANDS : n;
+	}
+
+	void setreq(Request& r, const float *xover, int nbands)
+	{
+		int i;
+
+		r.srate = srate;
+		r.nbands = clampbands(nbands);
+		for (i = 0; i < XOVER_MAXBANDS - 1; i++)
+			r.xover[i] = (i < r.nbands - 1) ? xover[i] : 0.f;
+	}
+
+	void setup(float rate)
+	{
+		fir.stop();
+		reset();
+		outbands = 0;
+
+		/* Keep the frequency resolution roughly constant across rates */
+		srate = rate;
+		taps = 4096;
+		while (taps * 48000.f < srate * 4096.f && taps < 65536)
+			taps *= 2;
+		taps--;
+		latency = XOVER_FRAG + (taps - 1) / 2;
+
+		/* The stream starts here, so the silent history is a valid one */
+		filled = taps + 1;
+	}
+
+	void run_fragment()
+	{
+		Filterbank *fb = fir.fragment(&inbuf[0][0]);
+		int c, b;
+
+		if (!fb) {
+			outbands = 0;
+			return;
+		}
+		outbands = fb->nout;
+		for (c = 0; c < nch; c++)
+			for (b = 0; b < outbands; b++)
+				memcpy(outbuf[c][b], fb->proc.outdata(c * outbands + b), XOVER_FRAG * sizeof(float));
+	}
+
+	/* Windowed sinc lowpass with unity gain at DC */
+	void lowpass(float *h, float f, float rate)
+	{
+		double fc = f / rate;
+		double c = (taps - 1) / 2.;
+		double sum = 0.;
+		int n;
+
+		if (fc > 0.49)
+			fc = 0.49;
+		if (fc < 1e-5)
+			fc = 1e-5;
+		for (n = 0; n < taps; n++) {
+			double t = n - c;
+			double w = 0.42 - 0.5 * cos(2. * M_PI * n / (taps - 1))
+				+ 0.08 * cos(4. * M_PI * n / (taps - 1));
+			double s = (t == 0.) ? 2. * fc : sin(2. * M_PI * fc * t) / (M_PI * t);
+			h[n] = s * w;
+			sum += h[n];
+		}
+		for (n = 0; n < taps; n++)
+			h[n] /= sum;
+	}
+
+	static Filterbank *static_design(void *arg, const Request& r)
+	{
+		return ((ZamFIRCrossover *)arg)->design(r);
+	}
+
+	Filterbank *design(const Request& r)
+	{
+		Filterbank *fb = new Filterbank();
+		float *lo = new float[taps];
+		float *hi = new float[taps];
+		float *h = new float[taps];
+		int b, c, n;
+		bool ok = true;
+
+		fb->nout = r.nbands;
+		memset(lo, 0, taps * sizeof(float));
+
+		if (fb->proc.configure(nch, nch * r.nbands, taps,
+				XOVER_FRAG, XOVER_FRAG, XOVER_FRAG, 0.f))
+			ok = false;
+
+		for (b = 0; ok && b < r.nbands; b++) {
+			if (b < r.nbands - 1) {
+				lowpass(hi, r.xover[b], r.srate);
+			} else {
+				memset(hi, 0, taps * sizeof(float));
+				hi[(taps - 1) / 2] = 1.f;
+			}
+			for (n = 0; n < taps; n++) {
+				h[n] = hi[n] - lo[n];
+				lo[n] = hi[n];
+			}
+			if (fb->proc.impdata_create(0, b, 1, h, 0, taps))
+				ok = false;
+			for (c = 1; ok && c < nch; c++)
+				if (fb->proc.impdata_link(0, b, c, c * r.nbands + b))
+					ok = false;
+		}
+		if (ok && fb->proc.start_process(0, 0))
+			ok = false;
+
+		delete[] lo;
+		delete[] hi;
+		delete[] h;
+		if (!ok) {
+			delete fb;
+			return NULL;
+		}
+		return fb;
+	}
+
+	int nch;
+	int taps;
+	uint32_t latency;
+	float srate;
+
+	/* Audio thread only */
+	uint32_t filled;
+	float inbuf[XOVER_MAXCHAN][XOVER_FRAG];
+	float outbuf[XOVER_MAXCHAN][XOVER_MAXBANDS][XOVER_FRAG];
+	int outbands;
+	int pos;
+
+	ZamFIRWorker<Request> fir;
+};
+
+#endif
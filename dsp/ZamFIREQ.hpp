@@ -0,0 +1,337 @@
+/*
+ * ZamFIREQ FIR rendering of an equaliser curve for zam-plugins
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#ifndef ZAMFIREQ_HPP_INCLUDED
+#define ZAMFIREQ_HPP_INCLUDED
+
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "ZamFIRWorker.hpp"
+
+#define FIREQ_MAXCHAN 8
+#define FIREQ_FRAG 256		/* convolution block, power of two */
+
+#define FIREQ_LINEAR 0
+#define FIREQ_MINIMUM 1
+
+/*
+ * Applies the magnitude response of an equaliser as one linear phase or
+ * minimum phase FIR.
+ *
+ * Curve is a trivially copyable description of the equaliser, with
+ * double magnitude(double w) const for w in radians per sample, such as a
+ * ZamBiquadCascade holding only coefficients. When it changes, a
+ * ZamFIRWorker samples it across the spectrum and designs the impulse: zero
+ * phase from an inverse FFT, or minimum phase from the folded cepstrum of
+ * the log magnitude. It is then windowed to the filter length.
+ *
+ * All channels share the filter and are convolved by one zita-convolver
+ * instance in FIREQ_FRAG blocks, so any host buffer size works. A new
+ * filter only takes over once its history is full, so changes do not
+ * drop out.
+ *
+ * Nothing is designed until the filter is first wanted, so a plugin can
+ * carry one for a mode that is switched off.
+ */
+
+template <class Curve>
+class ZamFIREQ
+{
+public:
+	/* length is the filter length at 48 kHz, a power of two */
+	ZamFIREQ(int nchannels, int phasemode = FIREQ_LINEAR, int length = 8192)
+		: nch(nchannels),
+		  phase(phasemode),
+		  baselen(length),
+		  taps(0),
+		  latency(0),
+		  fir(static_design, this, nchannels, FIREQ_FRAG)
+	{
+		memset(inbuf, 0, sizeof(inbuf));
+		memset(outbuf, 0, sizeof(outbuf));
+		pos = 0;
+		filled = 0;
+	}
+
+	~ZamFIREQ()
+	{
+		fir.stop();
+	}
+
+	/*
+	 * Not realtime safe, call from activate(): sizes the filter for the
+	 * rate, drops the old one and starts the worker. The first update()
+	 * designs the filter.
+	 */
+	void init(float srate)
+	{
+		setup(srate);
+		fir.start(taps, NULL);
+	}
+
+	/*
+	 * Not realtime safe, call from activate() when the filter is in use:
+	 * designs the first filter in place and starts the worker.
+	 */
+	void init(float srate, const Curve& curve)
+	{
+		setup(srate);
+		fir.start(taps, &curve);
+	}
+
+	/*
+	 * Realtime safe, cheap when nothing changed: call once per block
+	 * while the filter is wanted. Hands a changed curve to the worker.
+	 */
+	void update(const Curve& curve)
+	{
+		fir.post(curve);
+	}
+
+	/* Flush the filter history, for when the filter was not in use */
+	void reset()
+	{
+		memset(inbuf, 0, sizeof(inbuf));
+		memset(outbuf, 0, sizeof(outbuf));
+		pos = 0;
+		filled = 0;
+		fir.reset();
+	}
+
+	uint32_t getLatency() const
+	{
+		return latency;
+	}
+
+	/*
+	 * True once the running filter matches the last update() and has
+	 * seen a full filter length since reset(), so its output can take
+	 * over from another path without playing a stale curve.
+	 */
+	bool current() const
+	{
+		if (filled <= (uint32_t)taps)
+			return false;
+		return fir.current();
+	}
+
+	/*
+	 * A block of planar audio delayed by getLatency(), in place is fine.
+	 * With out NULL the filter is only fed, to fill its history.
+	 */
+	void process(const float * const *in, float * const *out, uint32_t frames)
+	{
+		uint32_t i = 0, n;
+		int c;
+
+		while (i < frames) {
+			n = frames - i;
+			if (n > (uint32_t)(FIREQ_FRAG - pos))
+				n = FIREQ_FRAG - pos;
+			for (c = 0; c < nch; c++) {
+				memcpy(&inbuf[c][pos], &in[c][i], n * sizeof(float));
+				if (out)
+					memcpy(&out[c][i], &outbuf[c][pos], n * sizeof(float));
+			}
+			i += n;
+			pos += n;
+			if (filled <= (uint32_t)taps)
+				filled += n;
+			if (pos == FIREQ_FRAG) {
+				pos = 0;
+				run_fragment();
+			}
+		}
+	}
+
+private:
+	typedef typename ZamFIRWorker<Curve>::Filter Filter;
+
+	void setup(float srate)
+	{
+		fir.stop();
+		reset();
+
+		/* Keep the frequency resolution roughly constant across rates */
+		taps = baselen;
+		while (taps * 48000.f < srate * baselen && taps < 8 * baselen)
+			taps *= 2;
+		taps--;
+		if (phase == FIREQ_MINIMUM)
+			latency = FIREQ_FRAG;
+		else
+			latency = FIREQ_FRAG + (taps - 1) / 2;
+
+		/* The stream starts here, so the silent history is a valid one */
+		filled = taps + 1;
+	}
+
+	void run_fragment()
+	{
+		Filter *f = fir.fragment(&inbuf[0][0]);
+		int c;
+
+		if (!f) {
+			memset(outbuf, 0, sizeof(outbuf));
+			return;
+		}
+		for (c = 0; c < nch; c++)
+			memcpy(outbuf[c], f->proc.outdata(c), FIREQ_FRAG * sizeof(float));
+	}
+
+	/* Blackman windowed, centred zero phase impulse */
+	void linphase(const Curve& curve, float *h)
+	{
+		int m = taps + 1;
+		int mid = (taps - 1) / 2;
+		float *buf = (float *)fftwf_malloc(m * sizeof(float));
+		fftwf_complex *spec = (fftwf_complex *)fftwf_malloc((m / 2 + 1) * sizeof(fftwf_complex));
+		fftwf_plan plan;
+		int k, n;
+
+		plan = fftwf_plan_dft_c2r_1d(m, spec, buf, FFTW_ESTIMATE);
+
+		/* Zero phase spectrum, scaled for the unnormalised inverse FFT */
+		for (k = 0; k <= m / 2; k++) {
+			spec[k][0] = curve.magnitude(2. * M_PI * k / m) / m;
+			spec[k][1] = 0.f;
+		}
+		fftwf_execute(plan);
+
+		/* Centre the impulse and window it to the filter length */
+		for (n = 0; n < taps; n++) {
+			double w = 0.42 - 0.5 * cos(2. * M_PI * n / (taps - 1))
+				+ 0.08 * cos(4. * M_PI * n / (taps - 1));
+			h[n] = buf[(n - mid + m) % m] * w;
+		}
+
+		fftwf_destroy_plan(plan);
+		fftwf_free(buf);
+		fftwf_free(spec);
+	}
+
+	/*
+	 * Homomorphic minimum phase impulse. The cepstrum is taken on a grid
+	 * four times the filter length to keep its aliasing down, and only
+	 * the last quarter of the impulse is tapered.
+	 */
+	void minphase(const Curve& curve, float *h)
+	{
+		int m = 4 * (taps + 1);
+		int fade = taps / 4;
+		float *buf = (float *)fftwf_malloc(m * sizeof(float));
+		fftwf_complex *spec = (fftwf_complex *)fftwf_malloc((m / 2 + 1) * sizeof(fftwf_complex));
+		fftwf_plan fwd, inv;
+		int k, n;
+
+		fwd = fftwf_plan_dft_r2c_1d(m, buf, spec, FFTW_ESTIMATE);
+		inv = fftwf_plan_dft_c2r_1d(m, spec, buf, FFTW_ESTIMATE);
+
+		/* Real cepstrum of the magnitude, floored at -120 dB */
+		for (k = 0; k <= m / 2; k++) {
+			double mag = curve.magnitude(2. * M_PI * k / m);
+			spec[k][0] = log(mag > 1e-6 ? mag : 1e-6) / m;
+			spec[k][1] = 0.f;
+		}
+		fftwf_execute(inv);
+
+		/* Fold the anticausal part onto the causal part */
+		for (n = 1; n < m / 2; n++)
+			buf[n] *= 2.f;
+		for (n = m / 2 + 1; n < m; n++)
+			buf[n] = 0.f;
+		fftwf_execute(fwd);
+
+		for (k = 0; k <= m / 2; k++) {
+			double g = exp(spec[k][0]) / m;
+			double ph = spec[k][1];
+			spec[k][0] = g * cos(ph);
+			spec[k][1] = g * sin(ph);
+		}
+		fftwf_execute(inv);
+
+		for (n = 0; n < taps; n++) {
+			double w = 1.;
+			if (n > taps - fade)
+				w = 0.5 + 0.5 * cos(M_PI * (n - (taps - fade)) / fade);
+			h[n] = buf[n] * w;
+		}
+
+		fftwf_destroy_plan(fwd);
+		fftwf_destroy_plan(inv);
+		fftwf_free(buf);
+		fftwf_free(spec);
+	}
+
+	Filter *design(const Curve& curve)
+	{
+		Filter *f = new Filter();
+		float *h = new float[taps];
+		int c;
+		bool ok = true;
+
+		f->nout = 1;
+		if (f->proc.configure(nch, nch, taps,
+				FIREQ_FRAG, FIREQ_FRAG, FIREQ_FRAG, 0.f))
+			ok = false;
+
+		if (phase == FIREQ_MINIMUM)
+			minphase(curve, h);
+		else
+			linphase(curve, h);
+
+		if (ok && f->proc.impdata_create(0, 0, 1, h, 0, taps))
+			ok = false;
+		for (c = 1; ok && c < nch; c++)
+			if (f->proc.impdata_link(0, 0, c, c))
+				ok = false;
+
+		if (ok && f->proc.start_process(0, 0))
+			ok = false;
+
+		delete[] h;
+		if (!ok) {
+			delete f;
+			return NULL;
+		}
+		return f;
+	}
+
+	static Filter *static_design(void *arg, const Curve& curve)
+	{
+		return ((ZamFIREQ *)arg)->design(curve);
+	}
+
+	int nch;
+	int phase;
+	int baselen;
+	int taps;
+	uint32_t latency;
+
+	/* Audio thread only */
+	uint32_t filled;
+	float inbuf[FIREQ_MAXCHAN][FIREQ_FRAG];
+	float outbuf[FIREQ_MAXCHAN][FIREQ_FRAG];
+	int pos;
+
+	ZamFIRWorker<Curve> fir;
+};
+
+#endif
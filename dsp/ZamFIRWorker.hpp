@@ -0,0 +1,290 @@
+/*
+ * ZamFIRWorker background FIR design and handover for zam-plugins
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#ifndef ZAMFIRWORKER_HPP_INCLUDED
+#define ZAMFIRWORKER_HPP_INCLUDED
+
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+
+#ifdef HAVE_ZITA_CONVOLVER
+#include <zita-convolver.h>
+#else
+#include "../lib/zita-convolver-4.0.0/zita-convolver.h"
+#endif
+
+/*
+ * Designs FIR filters on a worker thread and hands them to the audio
+ * thread, for ZamFIREQ and ZamFIRCrossover.
+ *
+ * Request is a trivially copyable description of the filter. The audio
+ * thread posts it through a triple buffer, so neither side ever waits
+ * and the worker always picks up the latest one. The design callback
+ * returns a configured and started Convproc, which is fed alongside the
+ * running one until it has seen a full filter length and only then takes
+ * over. The old one goes back to the worker to be freed.
+ *
+ * Only post(), current(), fragment() and reset() are realtime safe.
+ */
+
+template <class Request>
+class ZamFIRWorker
+{
+public:
+	struct Filter {
+		Convproc proc;
+		int nout;	/* outputs per input channel */
+	};
+
+	typedef Filter *(*Design)(void *arg, const Request& r);
+
+	ZamFIRWorker(Design fn, void *fnarg, int nchannels, int fragsize)
+		: design(fn),
+		  arg(fnarg),
+		  nch(nchannels),
+		  frag(fragsize),
+		  taps(0),
+		  cur(NULL),
+		  warm(NULL),
+		  warmcount(0),
+		  posted(0),
+		  wslot(0),
+		  havelast(false),
+		  rslot(2),
+		  havedesign(false),
+		  running(false)
+	{
+		next = NULL;
+		retired = NULL;
+		latest = 1;
+		doneseq = 0;
+		quit = false;
+		/*
+		 * Plugins in one host share libfftw3f, so serialise planning
+		 * inside it rather than behind a lock of our own
+		 */
+		fftwf_make_planner_thread_safe();
+	}
+
+	~ZamFIRWorker()
+	{
+		stop();
+	}
+
+	/*
+	 * Not realtime safe, call from activate(): starts the worker for
+	 * filters of length filtertaps. With first the initial filter is
+	 * designed in place, otherwise the first post() has it designed.
+	 */
+	void start(int filtertaps, const Request *first)
+	{
+		stop();
+
+		taps = filtertaps;
+		if (first) {
+			cur = design(arg, *first);
+			designed = *first;
+			havedesign = (cur != NULL);
+			last = *first;
+			havelast = true;
+		}
+		quit = false;
+		running = (pthread_create(&worker, NULL, static_main, this) == 0);
+	}
+
+	/* Not realtime safe: joins the worker and drops all filters */
+	void stop()
+	{
+		if (running) {
+			quit = true;
+			sema.post();
+			pthread_join(worker, NULL);
+			running = false;
+		}
+		delete cur;
+		delete warm;
+		delete next.exchange(NULL);
+		delete retired.exchange(NULL);
+		cur = warm = NULL;
+		warmcount = 0;
+		posted = 0;
+		wslot = 0;
+		latest = 1;
+		rslot = 2;
+		doneseq = 0;
+		havelast = false;
+		havedesign = false;
+	}
+
+	/* Realtime safe, cheap when r is the request posted last */
+	void post(const Request& r)
+	{
+		if (havelast && !memcmp(&r, &last, sizeof(Request)))
+			return;
+		last = r;
+		havelast = true;
+
+		slots[wslot].req = r;
+		slots[wslot].seq = ++posted;
+		wslot = latest.exchange(wslot | FRESH) & SLOTMASK;
+		sema.post();
+	}
+
+	/* True once the running filter is the one for the last post() */
+	bool current() const
+	{
+		if (!cur || warm)
+			return false;
+		/* doneseq first, the worker hands over next before setting it */
+		if (doneseq.load() != posted)
+			return false;
+		return next.load() == NULL;
+	}
+
+	/* Drop the history of the running filters */
+	void reset()
+	{
+		if (cur)
+			cur->proc.reset();
+		if (warm)
+			warm->proc.reset();
+		warmcount = 0;
+	}
+
+	/*
+	 * Runs one fragment, in holds nch rows of frag frames. Returns the
+	 * filter whose outputs are valid, or NULL when none is designed yet.
+	 */
+	Filter *fragment(const float *in)
+	{
+		bool fed = false;
+
+		if (!warm) {
+			warm = next.exchange(NULL);
+			warmcount = 0;
+		}
+		if (warm) {
+			feed(warm, in);
+			warmcount += frag;
+			/* Swap once the new filter has seen a full filter length */
+			if (warmcount > (uint32_t)taps && retired.load() == NULL) {
+				retired.store(cur);
+				cur = warm;
+				warm = NULL;
+				fed = true;
+				sema.post();
+			}
+		}
+		if (cur && !fed)
+			feed(cur, in);
+		return cur;
+	}
+
+private:
+	enum {
+		SLOTMASK = 3,
+		FRESH = 4
+	};
+
+	struct Slot {
+		Request req;
+		unsigned seq;
+	};
+
+	void feed(Filter *f, const float *in)
+	{
+		int c, i;
+
+		for (c = 0; c < nch; c++) {
+			float *id = f->proc.inpdata(c);
+			for (i = 0; i < frag; i++)
+				id[i] = in[c * frag + i] + 1e-20f;
+		}
+		f->proc.process(false);
+	}
+
+	static void *static_main(void *arg)
+	{
+		((ZamFIRWorker *)arg)->main();
+		return NULL;
+	}
+
+	void main()
+	{
+		for (;;) {
+			sema.wait();
+			if (quit)
+				break;
+
+			delete retired.exchange(NULL);
+
+			if (!(latest.load() & FRESH))
+				continue;
+			rslot = latest.exchange(rslot) & SLOTMASK;
+			const Slot& s = slots[rslot];
+
+			if (havedesign && !memcmp(&s.req, &designed, sizeof(Request))) {
+				doneseq.store(s.seq);
+				continue;
+			}
+
+			Filter *f = design(arg, s.req);
+			if (f) {
+				designed = s.req;
+				havedesign = true;
+				delete next.exchange(f);
+				doneseq.store(s.seq);
+			}
+		}
+	}
+
+	Design design;
+	void *arg;
+	int nch;
+	int frag;
+	int taps;
+
+	/* Audio thread only */
+	Filter *cur;
+	Filter *warm;
+	uint32_t warmcount;
+	unsigned posted;
+	int wslot;
+	Request last;
+	bool havelast;
+
+	/* Worker only once started */
+	int rslot;
+	Request designed;
+	bool havedesign;
+
+	/* Handed between the audio thread and the worker */
+	Slot slots[3];
+	std::atomic<int> latest;	/* slot of the newest request, | FRESH */
+	std::atomic<Filter *> next;
+	std::atomic<Filter *> retired;
+	std::atomic<unsigned> doneseq;	/* last request the worker dealt with */
+	std::atomic<bool> quit;
+
+	ZCsema sema;
+	pthread_t worker;
+	bool running;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * ZamSlidingMax running maximum over a sliding window
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#ifndef ZAMSLIDINGMAX_HPP_INCLUDED
+#define ZAMSLIDINGMAX_HPP_INCLUDED
+
+#include <stdint.h>
+
+/*
+ * Monotonic deque: every value is pushed and popped at most once, so the
+ * maximum of the last `window` values costs O(1) amortised per sample.
+ * SIZE must be a power of two and bounds the window length.
+ */
+
+template <typename T, uint32_t SIZE>
+class ZamSlidingMax
+{
+public:
+	ZamSlidingMax()
+		: window(SIZE)
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		head = tail = 0;
+		count = 0;
+	}
+
+	/* Keeps the values that are still inside the new window, so the
+	 * window can change while running without losing the current maximum */
+	void setWindow(uint32_t n)
+	{
+		if (n < 1)
+			n = 1;
+		if (n > SIZE)
+			n = SIZE;
+		window = n;
+		while (tail != head && count - idx[head & MASK] > window)
+			head++;
+	}
+
+	uint32_t getWindow() const
+	{
+		return window;
+	}
+
+	/* Expires the head before writing: a strictly decreasing run can fill
+	 * all SIZE slots, and the new value would land on top of the maximum */
+	void push(T v)
+	{
+		while (tail != head && count - idx[head & MASK] >= window)
+			head++;
+		while (tail != head && val[(tail - 1) & MASK] <= v)
+			tail--;
+		val[tail & MASK] = v;
+		idx[tail & MASK] = count;
+		tail++;
+		count++;
+	}
+
+	/* Maximum of the last `window` pushed values, 0 before anything is pushed */
+	T max() const
+	{
+		return (tail != head) ? val[head & MASK] : (T)0;
+	}
+
+private:
+	enum { MASK = SIZE - 1 };
+
+	T val[SIZE];
+	uint32_t idx[SIZE];
+	uint32_t window;
+	uint32_t head, tail, count;
+};
+
+#endif
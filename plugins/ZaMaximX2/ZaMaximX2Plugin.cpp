@@ -24,10 +24,20 @@ START_NAMESPACE_DISTRHO
 ZaMaximX2Plugin::ZaMaximX2Plugin()
     : Plugin(paramCount, 1, 0)
 {
+    z[0] = z[1] = emaxn = NULL;
+    bufsize = 0;
+
     // set default values
     loadProgram(0);
 }
 
+ZaMaximX2Plugin::~ZaMaximX2Plugin()
+{
+    free(z[0]);
+    free(z[1]);
+    free(emaxn);
+}
+
 // -----------------------------------------------------------------------
 // Init
 
@@ -62,6 +72,25 @@ void ZaMaximX2Plugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.min = -30.0f;
         parameter.ranges.max = 0.0f;
         break;
+    case paramTruePeak:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "True Peak";
+        parameter.symbol     = "truepeak";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    case paramLookahead:
+        // Changes the latency, so not automable
+        parameter.hints      = 0;
+        parameter.name       = "Lookahead";
+        parameter.symbol     = "lookahead";
+        parameter.unit       = "ms";
+        parameter.ranges.def = 10.0f;
+        parameter.ranges.min = 1.0f;
+        parameter.ranges.max = MAX_LOOKAHEAD;
+        break;
     case paramGainRed:
         parameter.hints      = kParameterIsOutput;
         parameter.name       = "Gain Reduction";
@@ -100,6 +129,8 @@ void ZaMaximX2Plugin::loadProgram(uint32_t index)
 		release = 25.0;
 		ceiling = 0.0;
 		thresdb = 0.0;
+		truepeak = 0.0;
+		lookahead = 10.0;
 		gainred = 0.0;
 		outlevel = -45.0;
 		break;
@@ -124,6 +155,12 @@ float ZaMaximX2Plugin::getParameterValue(uint32_t index) const
     case paramCeiling:
         return ceiling;
         break;
+    case paramTruePeak:
+        return truepeak;
+        break;
+    case paramLookahead:
+        return lookahead;
+        break;
     case paramGainRed:
         return gainred;
         break;
@@ -148,6 +185,12 @@ void ZaMaximX2Plugin::setParameterValue(uint32_t index, float value)
     case paramCeiling:
         ceiling = value;
         break;
+    case paramTruePeak:
+        truepeak = value;
+        break;
+    case paramLookahead:
+        lookahead = value;
+        break;
     case paramGainRed:
         gainred = value;
         break;
@@ -162,25 +205,96 @@ void ZaMaximX2Plugin::setParameterValue(uint32_t index, float value)
 
 void ZaMaximX2Plugin::activate()
 {
-    int i;
-
-    setLatency(MAX_DELAY);
+    uint32_t maxn = (uint32_t)(MAX_LOOKAHEAD * getSampleRate() / 1000.f);
+    uint32_t size = 1;
+
+    if (maxn > MAX_DELAY - 1)
+        maxn = MAX_DELAY - 1;
+    // Room for the true peak interpolator delay on top of the lookahead
+    while (size < maxn + TP_DELAY + 1)
+        size <<= 1;
+
+    if (size != bufsize) {
+        free(z[0]);
+        free(z[1]);
+        free(emaxn);
+        z[0] = (float *)malloc(size * sizeof(float));
+        z[1] = (float *)malloc(size * sizeof(float));
+        emaxn = (float *)malloc(size * sizeof(float));
+        if (!z[0] || !z[1] || !emaxn) {
+            // run() passes the audio through until an activate() succeeds
+            free(z[0]);
+            free(z[1]);
+            free(emaxn);
+            z[0] = z[1] = emaxn = NULL;
+            bufsize = 0;
+            setLatency(0);
+            return;
+        }
+        bufsize = size;
+        mask = size - 1;
+    }
 
     gainred = 0.0f;
     outlevel = -45.0f;
-    for (i = 0; i < MAX_DELAY; i++) {
-        cn[0][i] = z[0][i] = 0.f;
-        cn[1][i] = z[1][i] = 0.f;
-    }
-    for (i = 0; i < MAX_AVG; i++) {
-        emaxn[1][i] = 0.f;
-        emaxn[0][i] = 0.f;
-    }
-    posz[0] = posz[1] = 0;
-    pose[0] = pose[1] = 0;
-    posc[0] = posc[1] = 0;
+    tp[0].setMode(ZamDetector::DETECT_TRUEPEAK);
+    tp[1].setMode(ZamDetector::DETECT_TRUEPEAK);
+
+    memset(z[0], 0, bufsize * sizeof(float));
+    memset(z[1], 0, bufsize * sizeof(float));
+    memset(emaxn, 0, bufsize * sizeof(float));
+    cmax.reset();
+    tp[0].reset();
+    tp[1].reset();
+    posz = 0;
+    pose = 0;
+    fade = 0;
     emax_old[0] = emax_old[1] = 0.f;
     e_old[0] = e_old[1] = 0.f;
+
+    setlookahead();
+}
+
+/*
+ * Realtime safe, run() calls it when the lookahead or detection mode
+ * moves. The buffers always hold the longest lookahead, so only the
+ * windows and constants change and the limiter keeps its state.
+ *
+ * The true peak detector sees the input through the interpolator, which
+ * lags by TP_DELAY samples, so the audio is held back as long again to
+ * keep the full lookahead.
+ */
+void ZaMaximX2Plugin::setlookahead()
+{
+    uint32_t j;
+    double alpha = 1.0001;
+    double r;
+
+    N = (uint32_t)(lookahead * getSampleRate() / 1000.f);
+    if (N < 4)
+        N = 4;
+    if (N > bufsize - 1 - TP_DELAY)
+        N = bufsize - 1 - TP_DELAY;
+    navg = N / 4;
+    D = (truepeak > 0.5f) ? N + TP_DELAY : N;
+
+    setLatency(D);
+
+    cmax.setWindow(N);
+    emaxsum = 0.;
+    for (j = 0; j < navg; j++) {
+        emaxsum += emaxn[(pose - j) & mask];
+    }
+
+    // Attack and averaging constants only depend on the window lengths,
+    // beta is the mean of (1 - aatt)^(N + 1 - i) for i < navg in closed form
+    aatt = 1. - pow( (alpha - 1.) / alpha,  1. / ( N + 1. ) );
+    r = 1. - aatt;
+    beta = pow(r, N + 2. - navg) * (1. - pow(r, (double)navg)) / (1. - r);
+    beta /= navg;
+
+    oldlookahead = lookahead;
+    oldtruepeak = truepeak;
 }
 
 void ZaMaximX2Plugin::deactivate()
@@ -196,43 +310,31 @@ double ZaMaximX2Plugin::normalise(double in)
 	return from_dB(-thresdb + ceiling) * in;
 }
 
-void ZaMaximX2Plugin::pushsample(double in[], double sample, int *pos, int maxsamples)
+void ZaMaximX2Plugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
-	(*pos)++;
-	if (*pos >= maxsamples) {
-		*pos = 0;
-	}
-	in[*pos] = sample;
-}
+	uint32_t i, j;
 
-double ZaMaximX2Plugin::avgall(double in[])
-{
-	int i;
-	double avg = 0.f;
-	for (i = 0; i < MAX_AVG; i++) {
-		avg += in[i];
+	if (bufsize == 0) {
+		for (i = 0; i < frames; i++) {
+			outputs[0][i] = inputs[0][i];
+			outputs[1][i] = inputs[1][i];
+		}
+		gainred = 0.f;
+		outlevel = -45.f;
+		return;
 	}
-	avg = avg / (double)(MAX_AVG);
-	return avg;
-}
 
-double ZaMaximX2Plugin::maxsample(double in[])
-{
-	int i;
-	double max = 0.f;
-	for (i = 0; i < MAX_DELAY; i++) {
-		if (fabs(in[i]) > fabs(max)) {
-			max = in[i];
+	if (lookahead != oldlookahead || truepeak != oldtruepeak) {
+		// Fade from the old delay tap to the new one instead of jumping
+		if (truepeak != oldtruepeak) {
+			tp[0].reset();
+			tp[1].reset();
 		}
+		Dold = D;
+		fade = LOOKAHEAD_FADE;
+		setlookahead();
 	}
-	return max;
-}
 
-void ZaMaximX2Plugin::run(const float** inputs, float** outputs, uint32_t frames)
-{
-	uint32_t i;
-	double N = (double)MAX_DELAY;
-	double navg = (double)MAX_AVG;
 	double absx[2];
 	double c[2];
 	double xmax[2];
@@ -240,62 +342,83 @@ void ZaMaximX2Plugin::run(const float** inputs, float** outputs, uint32_t frames
 	double avge[2];
 	double g[2];
 	double srate = getSampleRate();
-	double alpha = 1.0001;
-	double aatt = 1. - pow( (alpha - 1.) / alpha,  1. / ( N + 1. ) );
+	double aattack = 1000 / (aatt * srate);
+	double arelease = 1000 / (release * srate);
+	double thresh = from_dB(thresdb);
+	double makeup = from_dB(ceiling - thresdb);
 	double a;
-	double beta;
 	double e;
 	double target;
 	double max;
 	double maxx = 0;
-	beta = 0.;
-	for (i = 0; i < navg; i++) {
-		beta += pow(1. - aatt, N + 1. - i);
-	}
-	beta /= navg;
+	bool usetruepeak = (truepeak > 0.5f);
 
 	double inL, inR;
 
 	for (i = 0; i < frames; i++) {
 		inL = inputs[0][i];
 		inR = inputs[1][i];
-		absx[0] = fmaxf(fabsf(inL), fabsf(inR));
+		if (usetruepeak) {
+			absx[0] = fmaxf(tp[0].process(inL), tp[1].process(inR));
+		} else {
+			absx[0] = fmaxf(fabsf(inL), fabsf(inR));
+		}
 		c[0] = fmaxf(absx[0], (absx[0]-beta*e_old[0]) / (1. - beta));
-		xmax[0] = maxsample(&cn[0][0]);
+		xmax[0] = cmax.max();
 		target = xmax[0];
 
 		if (target > emax_old[0]) {
-			a = 1000 / (aatt * srate);
+			a = aattack;
 		} else {
-			a = 1000 / (release * srate);
+			a = arelease;
 		}
 		emax[0] = (a*target + (1. - a)*emax_old[0]);
 //push
-		e = avgall(&emaxn[0][0]);
+		e = emaxsum / navg;
 		avge[0] = e;
-		avge[0] += emaxn[0][(pose[0]+1+MAX_AVG) % MAX_AVG]/(navg+1.);
+		avge[0] += emaxn[(pose - navg + 1) & mask] / (navg + 1.);
 		e = avge[0];
 
 		if (e == 0.f) {
 			g[0] = 1.;
 		} else {
-			g[0] = sanitize_denormal(fminf(1., from_dB(thresdb) / e));
+			g[0] = sanitize_denormal(fminf(1., thresh / e));
 		}
 
 		gainred = -to_dB(g[0]);
 
-		outputs[0][i] = z[0][(posz[0]+1+MAX_DELAY) % MAX_DELAY] * g[0] * from_dB(ceiling - thresdb);
-		outputs[1][i] = z[1][(posz[1]+1+MAX_DELAY) % MAX_DELAY] * g[0] * from_dB(ceiling - thresdb);
+		if (fade) {
+			float t = (float)fade / LOOKAHEAD_FADE;
+			outputs[0][i] = (z[0][(posz - D + 1) & mask] * (1.f - t)
+					+ z[0][(posz - Dold + 1) & mask] * t) * g[0] * makeup;
+			outputs[1][i] = (z[1][(posz - D + 1) & mask] * (1.f - t)
+					+ z[1][(posz - Dold + 1) & mask] * t) * g[0] * makeup;
+			fade--;
+		} else {
+			outputs[0][i] = z[0][(posz - D + 1) & mask] * g[0] * makeup;
+			outputs[1][i] = z[1][(posz - D + 1) & mask] * g[0] * makeup;
+		}
 
 		max = fmaxf(fabsf(outputs[0][i]), fabsf(outputs[1][i]));
 
 		if (maxx < max)
 			maxx = max;
 		
-		pushsample(&emaxn[0][0], sanitize_denormal(emax[0]), &pose[0], MAX_AVG);
-		pushsample(&cn[0][0], sanitize_denormal(c[0]), &posc[0], MAX_DELAY);
-		pushsample(&z[0][0], sanitize_denormal(inL), &posz[0], MAX_DELAY);
-		pushsample(&z[1][0], sanitize_denormal(inR), &posz[1], MAX_DELAY);
+		// Running sum of the envelope history, re-summed on wrap to cancel drift
+		emaxsum -= emaxn[(pose - navg + 1) & mask];
+		pose = (pose + 1) & mask;
+		emaxn[pose] = sanitize_denormal(emax[0]);
+		emaxsum += emaxn[pose];
+		if (pose == 0) {
+			emaxsum = 0.;
+			for (j = 0; j < navg; j++) {
+				emaxsum += emaxn[(pose - j) & mask];
+			}
+		}
+		cmax.push(sanitize_denormal(c[0]));
+		posz = (posz + 1) & mask;
+		z[0][posz] = sanitize_denormal(inL);
+		z[1][posz] = sanitize_denormal(inR);
 
 		emax_old[0] = sanitize_denormal(emax[0]);
 		e_old[0] = sanitize_denormal(e);
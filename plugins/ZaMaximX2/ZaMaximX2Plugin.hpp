@@ -17,9 +17,12 @@
 #define ZAMAXIMX2PLUGIN_HPP_INCLUDED
 
 #include "DistrhoPlugin.hpp"
+#include "../../dsp/ZamSlidingMax.hpp"
+#include "../../dsp/ZamDetector.hpp"
 
-#define MAX_DELAY 480
-#define MAX_AVG 120
+#define MAX_DELAY 8192		/* upper bound of the lookahead in samples */
+#define MAX_LOOKAHEAD 20.f	/* ms */
+#define LOOKAHEAD_FADE 256	/* samples to crossfade the delay tap over */
 
 START_NAMESPACE_DISTRHO
 
@@ -33,12 +36,15 @@ public:
         paramRelease = 0,
         paramCeiling,
         paramThresh,
+        paramTruePeak,
+        paramLookahead,
         paramGainRed,
         paramOutputLevel,
         paramCount
     };
 
     ZaMaximX2Plugin();
+    ~ZaMaximX2Plugin() override;
 
 protected:
     // -------------------------------------------------------------------
@@ -117,21 +123,26 @@ protected:
     void run(const float** inputs, float** outputs, uint32_t frames) override;
     double normalise(double in);
     double clip(double in);
-    double avgall(double in[]);
-    double maxsample(double in[]);
-    void pushsample(double in[], double sample, int *pos, int maxsamples);
     double getoldsample(double in[], int pos);
+    void setlookahead();
 
     // -------------------------------------------------------------------
 
 private:
-    float release,ceiling,thresdb,gainred,outlevel;//parameters
-    int pose[2], posz[2], posc[2];
-    double cn[2][MAX_DELAY];
-    double emaxn[2][MAX_AVG];
-    double z[2][MAX_DELAY];
+    float release,ceiling,thresdb,truepeak,lookahead,gainred,outlevel;//parameters
+    float oldlookahead, oldtruepeak;
+    uint32_t pose, posz;
+    uint32_t bufsize, mask;	// power of two ring buffers, allocated in activate()
+    uint32_t N, navg;		// lookahead and averaging window in samples
+    uint32_t D, Dold, fade;	// audio delay, the previous one and samples left in its crossfade
+    ZamSlidingMax<float, MAX_DELAY> cmax;
+    ZamDetector tp[2];
+    float *emaxn;
+    double emaxsum;
+    float *z[2];
     double emax_old[2];
     double e_old[2];
+    double aatt, beta;
 };
 
 // -----------------------------------------------------------------------
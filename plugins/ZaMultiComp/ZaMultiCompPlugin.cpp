@@ -22,7 +22,8 @@ START_NAMESPACE_DISTRHO
 // -----------------------------------------------------------------------
 
 ZaMultiCompPlugin::ZaMultiCompPlugin()
-    : Plugin(paramCount, 2, 0)
+    : Plugin(paramCount, 2, 0),
+      firxover(1)
 {
     // set default values
     loadProgram(0);
@@ -341,6 +342,15 @@ void ZaMultiCompPlugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.min = -45.0f;
         parameter.ranges.max = 20.0f;
         break;
+    case paramLinear:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "Linear phase crossover";
+        parameter.symbol     = "linphase";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
     }
 }
 
@@ -390,6 +400,7 @@ void ZaMultiCompPlugin::loadProgram(uint32_t index)
 		listen[1] = 0.0;
 		listen[2] = 0.0;
 		globalgain = 0.0;
+		linear = 0.0;
 		out = -45.0;
 		outlevel[0] = -45;
 		outlevel[1] = -45;
@@ -426,6 +437,7 @@ void ZaMultiCompPlugin::loadProgram(uint32_t index)
 		listen[1] = 0.0;
 		listen[2] = 0.0;
 		globalgain = 0.0;
+		linear = 0.0;
 		out = -45.0;
 		outlevel[0] = -45.0;
 		outlevel[1] = -45.0;
@@ -549,6 +561,9 @@ float ZaMultiCompPlugin::getParameterValue(uint32_t index) const
     case paramOutputLevelHigh:
         return outlevel[2];
         break;
+    case paramLinear:
+        return linear;
+        break;
     default:
         return 0.0f;
     }
@@ -672,6 +687,9 @@ void ZaMultiCompPlugin::setParameterValue(uint32_t index, float value)
     case paramOutputLevelHigh:
         outlevel[2] = value;
         break;
+    case paramLinear:
+        linear = value;
+        break;
     }
 }
 
@@ -715,9 +733,20 @@ void ZaMultiCompPlugin::activate()
 	pos[0] = 0;
 	pos[1] = 0;
 	pos[2] = 0;
+	for (i = 0; i < MAX_COMP; i++)
+		average[i] = bandsq[i] = 0.f;
 
 	oldxover1 = 0.f;
 	oldxover2 = 0.f;
+
+	/* The FIR bank is only designed here if linear mode is already on */
+	const float xover[2] = { xover1, xover2 };
+	if (linear > 0.5f)
+		firxover.init(getSampleRate(), xover, MAX_COMP);
+	else
+		firxover.init(getSampleRate());
+	oldlinear = -1;
+	oldwant = 1;
 }
 
 /*
@@ -828,12 +857,56 @@ void ZaMultiCompPlugin::run_comp(int k, float in, float *out)
         old_yg[k] = Lyg;
 }
 
-void ZaMultiCompPlugin::pushsample(float sample, int k)
+/*
+ * True when the block is below -120 dBFS and the crossovers and active
+ * compressors have decayed to rest. Such a block sits far below any knee,
+ * so the detectors are skipped and the bands pass at unity gain; the
+ * crossovers keep running. Leftover gain reduction is cleared.
+ */
+bool ZaMultiCompPlugin::settled(const float *in, uint32_t frames)
+{
+	uint32_t i;
+	int j, k;
+
+	for (i = 0; i < frames; i++)
+		if (fabsf(in[i]) >= SILENCE)
+			return false;
+	for (j = 0; j < 2; j++)
+		for (i = 0; i < MAX_FILT; i++)
+			if (fabs(simper[j][i].s[0]) >= SILENCE || fabs(simper[j][i].s[1]) >= SILENCE)
+				return false;
+	for (k = 0; k < MAX_COMP; k++)
+		if (toggle[k] > 0.5f && old_yl[k] >= SETTLED)
+			return false;
+
+	for (k = 0; k < MAX_COMP; k++) {
+		if (toggle[k] > 0.5f) {
+			old_yl[k] = 0.f;
+			gainr[k] = 0.f;
+		}
+	}
+	return true;
+}
+
+/*
+ * Called once per block instead of per sample: the 5 Hz level smoother is
+ * advanced by the whole block using its mean energy.
+ */
+void ZaMultiCompPlugin::update_meters(uint32_t frames)
 {
 	const float rate = 2. * M_PI * 5.;
 	float lpf = rate / (rate + getSampleRate());
-
-	average[k] += lpf * (sample*sample - average[k]);
+	float decay = 1.f - powf(1.f - lpf, frames);
+	int k;
+
+	if (frames == 0)
+		return;
+	for (k = 0; k < MAX_COMP; k++) {
+		average[k] = sanitize_denormal(average[k] + decay * (bandsq[k] / frames - average[k]));
+		outlevel[k] = sqrt(average[k]);
+		outlevel[k] = (outlevel[k] == 0.f) ? -45.0 : to_dB(outlevel[k]);
+		bandsq[k] = 0.f;
+	}
 }
 
 void ZaMultiCompPlugin::run(const float** inputs, float** outputs, uint32_t frames)
@@ -848,6 +921,27 @@ void ZaMultiCompPlugin::run(const float** inputs, float** outputs, uint32_t fram
         int listen2 = (listen[1] > 0.5f) ? 1 : 0;
         int listen3 = (listen[2] > 0.5f) ? 1 : 0;
 
+	/*
+	 * The linear phase splitter takes over once it matches the current
+	 * crossovers and has a full history, until then the IIR splitter
+	 * keeps playing with no latency and the FIR bank is only fed.
+	 */
+	int wantlinear = (linear > 0.5f) ? 1 : 0;
+	const float xover[2] = { xover1, xover2 };
+
+	if (wantlinear) {
+		if (!oldwant)
+			firxover.reset();
+		firxover.update(xover, MAX_COMP);
+	}
+	oldwant = wantlinear;
+
+	int linearmode = (wantlinear && (oldlinear == 1 || firxover.current())) ? 1 : 0;
+	if (linearmode != oldlinear) {
+		setLatency(linearmode ? firxover.getLatency() : 0);
+		oldlinear = linearmode;
+	}
+
         if (oldxover1 != xover1) {
 		// recalculate coeffs
 		calc_lr4(xover1, 0);
@@ -859,6 +953,9 @@ void ZaMultiCompPlugin::run(const float** inputs, float** outputs, uint32_t fram
 		oldxover2 = xover2;
 	}
 
+	// Silent input with everything at rest: no detector work this block
+	int idle = (!linearmode && settled(inputs[0], frames)) ? 1 : 0;
+
         for (uint32_t i = 0; i < frames; ++i) {
                 float tmp1[2], tmp2[2], tmp3[2];
 		float fil1[2], fil2[2], fil3[2], fil4[2];
@@ -868,30 +965,39 @@ void ZaMultiCompPlugin::run(const float** inputs, float** outputs, uint32_t fram
 
 		int listenmode = 0;
 
-		// Interleaved channel processing
-                run_lr4(0, inl, &fil1[0], &fil2[0]);
-                run_lr4(1, fil2[0], &fil3[0], &fil4[0]);
+		if (linearmode) {
+			float split[XOVER_MAXBANDS];
+			firxover.process(&inl, split);
+			fil1[0] = split[0];
+			fil3[0] = split[1];
+			fil4[0] = split[2];
+		} else {
+			if (wantlinear)
+				firxover.process(&inl, NULL);
+                	run_lr4(0, inl, &fil1[0], &fil2[0]);
+                	run_lr4(1, fil2[0], &fil3[0], &fil4[0]);
+		}
 
-		pushsample(fil1[0], 0);
-		outlevel[0] = sqrt(average[0]);
-		outlevel[0] = (outlevel[0] == 0.f) ? -45.0 : to_dB(outlevel[0]);
-		if (tog1)
+		bandsq[0] += fil1[0] * fil1[0];
+		if (tog1 && idle)
+			outL[0] = sanitize_denormal(fil1[0]);
+		else if (tog1)
 			run_comp(0, fil1[0], &outL[0]);
 
 		tmp1[0] = tog1 ? outL[0] * from_dB(makeup[0]) : fil1[0];
 
-		pushsample(fil3[0], 1);
-		outlevel[1] = sqrt(average[1]);
-		outlevel[1] = (outlevel[1] == 0.f) ? -45.0 : to_dB(outlevel[1]);
-		if (tog2)
+		bandsq[1] += fil3[0] * fil3[0];
+		if (tog2 && idle)
+			outL[1] = sanitize_denormal(fil3[0]);
+		else if (tog2)
 			run_comp(1, fil3[0], &outL[1]);
 
                 tmp2[0] = tog2 ? outL[1] * from_dB(makeup[1]) : fil3[0];
 
-		pushsample(fil4[0], 2);
-		outlevel[2] = sqrt(average[2]);
-		outlevel[2] = (outlevel[2] == 0.f) ? -45.0 : to_dB(outlevel[2]);
-		if (tog3)
+		bandsq[2] += fil4[0] * fil4[0];
+		if (tog3 && idle)
+			outL[2] = sanitize_denormal(fil4[0]);
+		else if (tog3)
 			run_comp(2, fil4[0], &outL[2]);
 
                 tmp3[0] = tog3 ? outL[2] * from_dB(makeup[2]) : fil4[0];
@@ -926,6 +1032,7 @@ void ZaMultiCompPlugin::run(const float** inputs, float** outputs, uint32_t fram
 		}
         }
 	out = (maxx <= 0.f) ? -160.f : to_dB(maxx);
+	update_meters(frames);
 }
 
 // -----------------------------------------------------------------------
@@ -18,6 +18,7 @@
 
 #include "DistrhoPlugin.hpp"
 #include <algorithm>
+#include "../../dsp/ZamFIRCrossover.hpp"
 
 START_NAMESPACE_DISTRHO
 
@@ -26,6 +27,8 @@ START_NAMESPACE_DISTRHO
 #define MAX_SAMPLES 480
 #define DANGER 100000.f
 #define EPS 1e-20f
+#define SILENCE 1e-6f		/* -120 dBFS */
+#define SETTLED 1e-5f		/* dB of gain reduction treated as none */
 
 // -----------------------------------------------------------------------
 
@@ -73,6 +76,7 @@ public:
         paramGainR1,
         paramGainR2,
         paramGainR3,
+        paramLinear,
 
         paramCount
     };
@@ -180,18 +184,22 @@ protected:
     void linear_svf_reset(struct linear_svf *self);
     float run_linear_svf_xover(struct linear_svf *self, float in, float mixlow, float mixhigh);
 
-	void pushsample(float sample, int k);
+	void update_meters(uint32_t frames);
+	bool settled(const float *in, uint32_t frames);
     // -------------------------------------------------------------------
 
 private:
     float attack[MAX_COMP],release[MAX_COMP],knee[MAX_COMP],ratio[MAX_COMP],thresdb[MAX_COMP],makeup[MAX_COMP],globalgain;
-    float gainr[MAX_COMP],toggle[MAX_COMP],listen[MAX_COMP],max,out,xover1,xover2;
+    float gainr[MAX_COMP],toggle[MAX_COMP],listen[MAX_COMP],max,out,xover1,xover2,linear;
     float old_yl[MAX_COMP], old_y1[MAX_COMP], old_yg[MAX_COMP];
     float old_ll, old_l1;
     float limit, outlevel[3];
     int pos[3];
     float average[3];
+    float bandsq[3];
     float oldxover1, oldxover2;
+    int oldlinear, oldwant;
+    ZamFIRCrossover firxover;
     bool reset;
 
 };
@@ -22,7 +22,8 @@ START_NAMESPACE_DISTRHO
 // -----------------------------------------------------------------------
 
 ZaMultiCompX2Plugin::ZaMultiCompX2Plugin()
-    : Plugin(paramCount, 2, 0)
+    : Plugin(paramCount, 2, 0),
+      firxover(2)
 {
     // set default values
     loadProgram(0);
@@ -359,6 +360,232 @@ void ZaMultiCompX2Plugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.min = -45.0f;
         parameter.ranges.max = 20.0f;
         break;
+    case paramBands:
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.name       = "Bands";
+        parameter.symbol     = "bands";
+        parameter.unit       = " ";
+        parameter.ranges.def = 3.0f;
+        parameter.ranges.min = 2.0f;
+        parameter.ranges.max = MAX_BANDS;
+        break;
+    case paramXover3:
+    case paramXover4:
+    case paramXover5:
+    case paramXover6:
+    case paramXover7:
+        {
+        static const char* const names[] = { "Crossover freq 3", "Crossover freq 4",
+            "Crossover freq 5", "Crossover freq 6", "Crossover freq 7" };
+        static const char* const symbols[] = { "xover3", "xover4", "xover5", "xover6", "xover7" };
+        static const float defs[] = { 4000.0f, 7000.0f, 10000.0f, 13000.0f, 16000.0f };
+        parameter.hints      = kParameterIsAutomable | kParameterIsLogarithmic;
+        parameter.name       = names[index - paramXover3];
+        parameter.symbol     = symbols[index - paramXover3];
+        parameter.unit       = "Hz";
+        parameter.ranges.def = defs[index - paramXover3];
+        parameter.ranges.min = 20.0f;
+        parameter.ranges.max = 20000.0f;
+        }
+        break;
+    case paramLinear:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "Linear phase crossover";
+        parameter.symbol     = "linphase";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    default:
+        initBandParameter(index, parameter);
+        break;
+    }
+}
+
+/* Bands 4 and up are laid out as blocks of bandParamCount parameters */
+void ZaMultiCompX2Plugin::initBandParameter(uint32_t index, Parameter& parameter)
+{
+    char name[32], symbol[16];
+
+    if (index < paramBandStart || index >= paramCount)
+        return;
+
+    int k = 4 + (index - paramBandStart) / bandParamCount;
+
+    switch ((index - paramBandStart) % bandParamCount)
+    {
+    case bandAttack:
+        snprintf(name, sizeof(name), "Attack%d", k);
+        snprintf(symbol, sizeof(symbol), "att%d", k);
+        parameter.hints      = kParameterIsAutomable;
+        parameter.unit       = "ms";
+        parameter.ranges.def = 10.0f;
+        parameter.ranges.min = 0.1f;
+        parameter.ranges.max = 100.0f;
+        break;
+    case bandRelease:
+        snprintf(name, sizeof(name), "Release%d", k);
+        snprintf(symbol, sizeof(symbol), "rel%d", k);
+        parameter.hints      = kParameterIsAutomable;
+        parameter.unit       = "ms";
+        parameter.ranges.def = 80.0f;
+        parameter.ranges.min = 1.0f;
+        parameter.ranges.max = 500.0f;
+        break;
+    case bandKnee:
+        snprintf(name, sizeof(name), "Knee%d", k);
+        snprintf(symbol, sizeof(symbol), "kn%d", k);
+        parameter.hints      = kParameterIsAutomable;
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 8.0f;
+        break;
+    case bandRatio:
+        snprintf(name, sizeof(name), "Ratio%d", k);
+        snprintf(symbol, sizeof(symbol), "rat%d", k);
+        parameter.hints      = kParameterIsAutomable | kParameterIsLogarithmic;
+        parameter.unit       = " ";
+        parameter.ranges.def = 4.0f;
+        parameter.ranges.min = 1.0f;
+        parameter.ranges.max = 20.0f;
+        break;
+    case bandThresh:
+        snprintf(name, sizeof(name), "Threshold %d", k);
+        snprintf(symbol, sizeof(symbol), "thr%d", k);
+        parameter.hints      = kParameterIsAutomable;
+        parameter.unit       = "dB";
+        parameter.ranges.def = -16.0f;
+        parameter.ranges.min = -60.0f;
+        parameter.ranges.max = 0.0f;
+        break;
+    case bandMakeup:
+        snprintf(name, sizeof(name), "Makeup %d", k);
+        snprintf(symbol, sizeof(symbol), "mak%d", k);
+        parameter.hints      = kParameterIsAutomable;
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 30.0f;
+        break;
+    case bandToggle:
+        snprintf(name, sizeof(name), "ZamComp %d ON", k);
+        snprintf(symbol, sizeof(symbol), "toggle%d", k);
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    case bandListen:
+        snprintf(name, sizeof(name), "Listen %d", k);
+        snprintf(symbol, sizeof(symbol), "listen%d", k);
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    case bandGainR:
+        snprintf(name, sizeof(name), "Gain Reduction %d", k);
+        snprintf(symbol, sizeof(symbol), "gr%d", k);
+        parameter.hints      = kParameterIsAutomable | kParameterIsOutput;
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 20.0f;
+        break;
+    case bandOutputLevel:
+        snprintf(name, sizeof(name), "Output band %d", k);
+        snprintf(symbol, sizeof(symbol), "outband%d", k);
+        parameter.hints      = kParameterIsOutput;
+        parameter.unit       = "dB";
+        parameter.ranges.def = -45.0f;
+        parameter.ranges.min = -45.0f;
+        parameter.ranges.max = 20.0f;
+        break;
+    }
+    parameter.name   = name;
+    parameter.symbol = symbol;
+}
+
+float ZaMultiCompX2Plugin::getBandParameter(uint32_t index) const
+{
+    if (index < paramBandStart || index >= paramCount)
+        return 0.0f;
+
+    int k = 3 + (index - paramBandStart) / bandParamCount;
+
+    switch ((index - paramBandStart) % bandParamCount)
+    {
+    case bandAttack:
+        return attack[k];
+    case bandRelease:
+        return release[k];
+    case bandKnee:
+        return knee[k];
+    case bandRatio:
+        return ratio[k];
+    case bandThresh:
+        return thresdb[k];
+    case bandMakeup:
+        return makeup[k];
+    case bandToggle:
+        return toggle[k];
+    case bandListen:
+        return listen[k];
+    case bandGainR:
+        return gainr[k];
+    case bandOutputLevel:
+        return outlevel[k];
+    }
+    return 0.0f;
+}
+
+void ZaMultiCompX2Plugin::setBandParameter(uint32_t index, float value)
+{
+    if (index < paramBandStart || index >= paramCount)
+        return;
+
+    int k = 3 + (index - paramBandStart) / bandParamCount;
+
+    switch ((index - paramBandStart) % bandParamCount)
+    {
+    case bandAttack:
+        attack[k] = value;
+        break;
+    case bandRelease:
+        release[k] = value;
+        break;
+    case bandKnee:
+        knee[k] = value;
+        break;
+    case bandRatio:
+        ratio[k] = value;
+        break;
+    case bandThresh:
+        thresdb[k] = value;
+        break;
+    case bandMakeup:
+        makeup[k] = value;
+        break;
+    case bandToggle:
+        toggle[k] = value;
+        if (value == 0.f)
+            gainr[k] = 0.f;
+        break;
+    case bandListen:
+        listen[k] = value;
+        if (value == 0.f)
+            gainr[k] = 0.f;
+        break;
+    case bandGainR:
+        gainr[k] = value;
+        break;
+    case bandOutputLevel:
+        outlevel[k] = value;
+        break;
     }
 }
 
@@ -396,8 +623,8 @@ void ZaMultiCompX2Plugin::loadProgram(uint32_t index)
 		makeup[0] = 0.0;
 		makeup[1] = 0.0;
 		makeup[2] = 0.0;
-		xover1 = 160.0;
-		xover2 = 1400.0;
+		xover[0] = 160.0;
+		xover[1] = 1400.0;
 		gainr[0] = 0.0;
 		gainr[1] = 0.0;
 		gainr[2] = 0.0;
@@ -434,8 +661,8 @@ void ZaMultiCompX2Plugin::loadProgram(uint32_t index)
 		makeup[0] = 9.0;
 		makeup[1] = 6.0;
 		makeup[2] = 6.0;
-		xover1 = 160.0;
-		xover2 = 1400.0;
+		xover[0] = 160.0;
+		xover[1] = 1400.0;
 		gainr[0] = 0.0;
 		gainr[1] = 0.0;
 		gainr[2] = 0.0;
@@ -454,6 +681,27 @@ void ZaMultiCompX2Plugin::loadProgram(uint32_t index)
 		outlevel[2] = -45.0;
 		break;
 	}
+    /* Bands above the third start as copies of the top band */
+    for (int k = 3; k < MAX_BANDS; k++) {
+        attack[k] = attack[2];
+        release[k] = release[2];
+        knee[k] = knee[2];
+        ratio[k] = ratio[2];
+        thresdb[k] = thresdb[2];
+        makeup[k] = makeup[2];
+        gainr[k] = 0.0;
+        toggle[k] = toggle[2];
+        listen[k] = 0.0;
+        outlevel[k] = -45.0;
+    }
+    xover[2] = 4000.0;
+    xover[3] = 7000.0;
+    xover[4] = 10000.0;
+    xover[5] = 13000.0;
+    xover[6] = 16000.0;
+    bands = 3.0;
+    linear = 0.0;
+
     /* Default variable values */
     maxL = 0.f;
     maxR = 0.f;
@@ -533,10 +781,10 @@ float ZaMultiCompX2Plugin::getParameterValue(uint32_t index) const
         return gainr[2];
         break;
     case paramXover1:
-        return xover1;
+        return xover[0];
         break;
     case paramXover2:
-        return xover2;
+        return xover[1];
         break;
     case paramToggle1:
         return toggle[0];
@@ -577,8 +825,21 @@ float ZaMultiCompX2Plugin::getParameterValue(uint32_t index) const
     case paramOutputLevelHigh:
         return outlevel[2];
         break;
+    case paramBands:
+        return bands;
+        break;
+    case paramXover3:
+    case paramXover4:
+    case paramXover5:
+    case paramXover6:
+    case paramXover7:
+        return xover[2 + index - paramXover3];
+        break;
+    case paramLinear:
+        return linear;
+        break;
     default:
-        return 0.0f;
+        return getBandParameter(index);
     }
 }
 
@@ -650,10 +911,10 @@ void ZaMultiCompX2Plugin::setParameterValue(uint32_t index, float value)
         gainr[2] = value;
         break;
     case paramXover1:
-        xover1 = value;
+        xover[0] = value;
         break;
     case paramXover2:
-        xover2 = value;
+        xover[1] = value;
         break;
     case paramToggle1:
         toggle[0] = value;
@@ -706,6 +967,22 @@ void ZaMultiCompX2Plugin::setParameterValue(uint32_t index, float value)
     case paramOutputLevelHigh:
         outlevel[2] = value;
         break;
+    case paramBands:
+        bands = value;
+        break;
+    case paramXover3:
+    case paramXover4:
+    case paramXover5:
+    case paramXover6:
+    case paramXover7:
+        xover[2 + index - paramXover3] = value;
+        break;
+    case paramLinear:
+        linear = value;
+        break;
+    default:
+        setBandParameter(index, value);
+        break;
     }
 }
 
@@ -715,28 +992,34 @@ void ZaMultiCompX2Plugin::setParameterValue(uint32_t index, float value)
 void ZaMultiCompX2Plugin::activate()
 {
         int i,j;
-        for (i = 0; i < MAX_COMP; i++)
+        for (i = 0; i < MAX_BANDS; i++)
         	for (j = 0; j < 2; j++)
                 	old_yl[j][i]=old_y1[j][i]=old_yg[j][i]=0.f;
 
 	for (j = 0; j < 2; j++)
 		old_ll[j]=old_l1[j]=0.f;
 
-	for (j = 0; j < 2; j++) {
-		for (i = 0; i < MAX_FILT; i++) {
-			simper[j][i].k = 0.f;
-			simper[j][i].g = 0.f;
-			simper[j][i].s[0] = 0.f;
-			simper[j][i].s[1] = 0.f;
-		}
-        }
+	for (i = 0; i < MAX_XOVER; i++)
+		linear_svf_reset(&simper[i]);
 	maxL = maxR = 0.f;
-	pos[0] = 0;
-	pos[1] = 0;
-	pos[2] = 0;
+	for (i = 0; i < MAX_BANDS; i++) {
+		pos[i] = 0;
+		average[i] = 0.f;
+		bandsq[i] = 0.f;
+	}
+
+	meterpos = 0;
+
+	for (i = 0; i < MAX_XOVER; i++)
+		oldxover[i] = 0.f;
 
-	oldxover1 = 0.f;
-	oldxover2 = 0.f;
+	/* The FIR bank is only designed here if linear mode is already on */
+	if (linear > 0.5f)
+		firxover.init(getSampleRate(), xover, std::min(std::max((int)bands, 2), MAX_BANDS));
+	else
+		firxover.init(getSampleRate());
+	oldlinear = -1;
+	oldwant = 1;
 }
 
 /*
@@ -744,262 +1027,306 @@ void ZaMultiCompX2Plugin::activate()
  * https://cytomic.com/files/dsp/SvfInputMixing.pdf
  */
 
-void ZaMultiCompX2Plugin::linear_svf_set_xover(struct linear_svf *self, float sample_rate, float cutoff, float resonance)
+/*
+ * Solving the SVF for v1, v2 gives, per lane with its own low/high mix:
+ *   v1 = a1*s0 + b1*s1 + c1*in
+ *   v2 = a2*s0 + b2*s1 + c2*in
+ *   out = d*in + v2
+ * so the division and mixing are folded into coefficients here.
+ */
+void ZaMultiCompX2Plugin::linear_svf_set_xover(struct linear_svf4 *self, float sample_rate, float cutoff, float resonance)
 {
-	double w;
+	double k = 2. - 2. * resonance;
+	double g = tan(M_PI * cutoff / sample_rate);
+	double g2 = g*g;
+	double c = 1. / (1. + g2 + g*k);
+	int l;
 
-	self->k = 2. - 2. * resonance;
-	w = M_PI * cutoff / sample_rate;
-	self->g = tan(w);
-}
+	for (l = 0; l < LANES; l++) {
+		double mixlow = (l == LANE_LOW_L || l == LANE_LOW_R) ? 1. : 0.;
+		double mixhigh = 1. - mixlow;
 
-void ZaMultiCompX2Plugin::linear_svf_reset(struct linear_svf *self)
-{
-	self->s[0] = self->s[1] = 0.f;
+		self->a1[l] = c * (1. + g*k);
+		self->b1[l] = -c * g;
+		self->c1[l] = -c * (0.75*g2 + g*mixhigh - g*mixlow - g2*k*mixlow);
+		self->a2[l] = c * g;
+		self->b2[l] = c;
+		self->c2[l] = -c * (-0.75*g + g2*mixhigh + g*k*mixhigh - g2*mixlow);
+		self->d[l] = mixhigh;
+	}
 }
 
-float ZaMultiCompX2Plugin::run_linear_svf_xover(struct linear_svf *self, float in, float mixlow, float mixhigh)
+void ZaMultiCompX2Plugin::linear_svf_reset(struct linear_svf4 *self)
 {
-	double v[3];
-	double g = self->g;
-	double k = self->k;
-	double s0 = self->s[0];
-	double s1 = self->s[1];
-	double g2 = g*g;
-	double vhigh = in * mixhigh;
-	double vband = in * 0.75;
-	double vlow = in * mixlow;
+	int l;
 
-	v[0] = in;
-	v[1] = -1. / (1. + g2 + g*k) * (-s0 + g*s1 - g*k*s0 + g2*vband + g*vhigh - g*vlow - g2*k*vlow);
-	v[2] = -1. / (1. + g2 + g*k) * (-g*s0 - s1 - g*vband + g2*vhigh + g*k*vhigh - g2*vlow);
-	self->s[0] = 2. * v[1] - s0;
-	self->s[1] = 2. * v[2] - s1;
-
-	return (float)(vhigh + v[2]);
+	for (l = 0; l < LANES; l++)
+		self->s0[l] = self->s1[l] = 0.f;
 }
 
 void ZaMultiCompX2Plugin::calc_lr4(float f, int i)
 {
 	float srate = getSampleRate();
 
-	linear_svf_set_xover(&simper[0][i], srate, f, 0.25);
-	linear_svf_set_xover(&simper[1][i], srate, f, 0.25);
+	linear_svf_set_xover(&simper[i], srate, f, 0.25);
 }
 
-void ZaMultiCompX2Plugin::run_lr4(int i, float in, float *outlo, float *outhi)
+void ZaMultiCompX2Plugin::run_lr4(int i, float inl, float inr, float *out)
 {
-	*outlo = run_linear_svf_xover(&simper[0][i], in, 1., 0.);
-	*outhi = run_linear_svf_xover(&simper[1][i], in, 0., 1.);
+	struct linear_svf4 *self = &simper[i];
+	const float in[LANES] = { inl, inl, inr, inr };
+	int l;
+
+	for (l = 0; l < LANES; l++) {
+		float s0 = self->s0[l];
+		float s1 = self->s1[l];
+		float v1 = self->a1[l]*s0 + self->b1[l]*s1 + self->c1[l]*in[l];
+		float v2 = self->a2[l]*s0 + self->b2[l]*s1 + self->c2[l]*in[l];
+
+		self->s0[l] = 2.f * v1 - s0;
+		self->s1[l] = 2.f * v2 - s1;
+		out[l] = self->d[l]*in[l] + v2;
+	}
 }
 
-void ZaMultiCompX2Plugin::run_comp(int k, float inL, float inR, float *outL, float *outR)
+/*
+ * Compress one band over a chunk, in place. The static curve has no state
+ * and runs over the whole chunk first so it vectorizes; only the attack
+ * and release smoothing is serial.
+ */
+void ZaMultiCompX2Plugin::run_comp(int k, float *l, float *r, uint32_t n)
 {
-	float srate = getSampleRate();
-        float width = (6.f * knee[k]) + 0.01;
-        float attack_coeff = exp(-1000.f/(attack[k] * srate));
-        float release_coeff = exp(-1000.f/(release[k] * srate));
 	int stereolink = (stereodet > 0.5f) ? STEREOLINK_MAX : STEREOLINK_AVERAGE;
-	float checkwidth = 0.f;
-        float cdb=0.f;
-        float Lgain = 1.f;
-        float Rgain = 1.f;
-        float Lxg, Lyg;
-        float Rxg, Ryg;
-        float Lxl, Lyl;
-        float Rxl, Ryl;
-
-        Lyg = Ryg = 0.f;
-	inL = sanitize_denormal(inL);
-	inR = sanitize_denormal(inR);
-        Lxg = (inL==0.f) ? -160.f : to_dB(fabsf(inL));
-        Rxg = (inR==0.f) ? -160.f : to_dB(fabsf(inR));
-        Lxg = sanitize_denormal(Lxg);
-        Rxg = sanitize_denormal(Rxg);
-
-	checkwidth = 2.f*fabsf(Lxg-thresdb[k]);
-	if (2.f*(Lxg-thresdb[k]) < -width) {
-		Lyg = Lxg;
-	} else if (checkwidth <= width) {
-		Lyg = Lxg + (1.f/ratio[k]-1.f)*(Lxg-thresdb[k]+width/2.f)*(Lxg-thresdb[k]+width/2.f)/(2.f*width);
-		Lyg = sanitize_denormal(Lyg);
-	} else if (2.f*(Lxg-thresdb[k]) > width) {
-		Lyg = thresdb[k] + (Lxg-thresdb[k])/ratio[k];
-		Lyg = sanitize_denormal(Lyg);
-	}
-
-	checkwidth = 2.f*fabsf(Rxg-thresdb[k]);
-	if (2.f*(Rxg-thresdb[k]) < -width) {
-		Ryg = Rxg;
-	} else if (checkwidth <= width) {
-		Ryg = Rxg + (1.f/ratio[k]-1.f)*(Rxg-thresdb[k]+width/2.f)*(Rxg-thresdb[k]+width/2.f)/(2.f*width);
-		Ryg = sanitize_denormal(Ryg);
-	} else if (2.f*(Rxg-thresdb[k]) > width) {
-		Ryg = thresdb[k] + (Rxg-thresdb[k])/ratio[k];
-		Ryg = sanitize_denormal(Ryg);
-	}
+	float thr = thresdb[k];
+	float w = width[k];
+	float Lyl = old_yl[0][k];
+	float Ryl = old_yl[1][k];
+	float gr = gainr[k];
+	float xl[CHUNK];
+	uint32_t j;
 
-        if (stereolink == STEREOLINK_MAX) {
-                Lxl = Rxl = fmaxf(Lxg - Lyg, Rxg - Ryg);
-        } else {
-                Lxl = Rxl = (Lxg - Lyg + Rxg - Ryg) / 2.f;
-        }
+	for (j = 0; j < n; j++) {
+		float Lxg, Lyg;
+		float Rxg, Ryg;
+		float lv = sanitize_denormal(l[j]);
+		float rv = sanitize_denormal(r[j]);
 
-        old_yl[0][k] = sanitize_denormal(old_yl[0][k]);
-        old_yl[1][k] = sanitize_denormal(old_yl[1][k]);
+		Lxg = (lv==0.f) ? -160.f : to_dB(fabsf(lv));
+		Rxg = (rv==0.f) ? -160.f : to_dB(fabsf(rv));
 
+		Lyg = (2.f*(Lxg-thr) < -w) ? Lxg :
+			(2.f*fabsf(Lxg-thr) <= w) ? Lxg + slope[k]*(Lxg-thr+w/2.f)*(Lxg-thr+w/2.f)/(2.f*w) :
+			thr + (Lxg-thr)/ratio[k];
+		Ryg = (2.f*(Rxg-thr) < -w) ? Rxg :
+			(2.f*fabsf(Rxg-thr) <= w) ? Rxg + slope[k]*(Rxg-thr+w/2.f)*(Rxg-thr+w/2.f)/(2.f*w) :
+			thr + (Rxg-thr)/ratio[k];
 
-	if (Lxl < old_yl[0][k]) {
-		Lyl = release_coeff * old_yl[0][k] + (1.f-release_coeff)*Lxl;
-	} else if (Lxl > old_yl[0][k]) {
-		Lyl = attack_coeff * old_yl[0][k]+(1.f-attack_coeff)*Lxl;
-	} else {
-		Lyl = Lxl;
+		xl[j] = (stereolink == STEREOLINK_MAX) ? fmaxf(Lxg - Lyg, Rxg - Ryg) :
+			(Lxg - Lyg + Rxg - Ryg) / 2.f;
+		l[j] = lv;
+		r[j] = rv;
 	}
-        Lyl = sanitize_denormal(Lyl);
 
-        cdb = -Lyl;
-        Lgain = from_dB(cdb);
+	for (j = 0; j < n; j++) {
+		float x = xl[j];
 
-	if (Rxl < old_yl[1][k]) {
-		Ryl = release_coeff * old_yl[1][k] + (1.f-release_coeff)*Rxl;
-	} else if (Rxl > old_yl[1][k]) {
-		Ryl = attack_coeff * old_yl[1][k]+(1.f-attack_coeff)*Rxl;
-	} else {
-		Ryl = Rxl;
-	}
-        Ryl = sanitize_denormal(Ryl);
+		Lyl = (x < Lyl) ? relcoef[k] * Lyl + (1.f-relcoef[k])*x :
+			(x > Lyl) ? attcoef[k] * Lyl + (1.f-attcoef[k])*x : x;
+		Ryl = (x < Ryl) ? relcoef[k] * Ryl + (1.f-relcoef[k])*x :
+			(x > Ryl) ? attcoef[k] * Ryl + (1.f-attcoef[k])*x : x;
+		Lyl = sanitize_denormal(Lyl);
+		Ryl = sanitize_denormal(Ryl);
 
-        cdb = -Ryl;
-        Rgain = from_dB(cdb);
+		gr = (stereolink == STEREOLINK_MAX) ? fmaxf(Lyl, Ryl) : (Lyl + Ryl) / 2.f;
 
-        if (stereolink == STEREOLINK_MAX)
-		gainr[k] = fmaxf(Lyl, Ryl);
-	else
-        	gainr[k] = (Lyl + Ryl) / 2.f;
-
-	*outL = inL * Lgain;
-	*outR = inR * Rgain;
+		l[j] = l[j] * from_dB(-Lyl) * makeupgain[k];
+		r[j] = r[j] * from_dB(-Ryl) * makeupgain[k];
+	}
 
-        old_yl[0][k] = Lyl;
-        old_yl[1][k] = Ryl;
-        old_yg[0][k] = Lyg;
-        old_yg[1][k] = Ryg;
+	old_yl[0][k] = Lyl;
+	old_yl[1][k] = Ryl;
+	gainr[k] = gr;
 }
 
-void ZaMultiCompX2Plugin::pushsample(float sample, int k)
+/*
+ * Called once per metering interval instead of per sample: the 5 Hz level
+ * smoother is advanced by the whole interval using its mean energy.
+ */
+void ZaMultiCompX2Plugin::update_meters(int nbands)
 {
 	const float rate = 2. * M_PI * 5.;
 	float lpf = rate / (rate + getSampleRate());
+	float decay = 1.f - powf(1.f - lpf, meterpos);
+	int k;
 
-	average[k] += lpf * (sample*sample - average[k]);
+	for (k = 0; k < MAX_BANDS; k++) {
+		float meansq = (k < nbands) ? bandsq[k] / meterpos : 0.f;
+		average[k] = sanitize_denormal(average[k] + decay * (meansq - average[k]));
+		outlevel[k] = sqrt(average[k]);
+		outlevel[k] = (outlevel[k] == 0.f) ? -45.0 : to_dB(outlevel[k]);
+		bandsq[k] = 0.f;
+	}
+	meterpos = 0;
 }
 
 void ZaMultiCompX2Plugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
 	float maxxL = 0.;
 	float maxxR = 0.;
-	uint32_t i;
-
-        int tog1 = (toggle[0] > 0.5f) ? 1 : 0;
-        int tog2 = (toggle[1] > 0.5f) ? 1 : 0;
-        int tog3 = (toggle[2] > 0.5f) ? 1 : 0;
+	float srate = getSampleRate();
+	int nbands = std::min(std::max((int)bands, 2), MAX_BANDS);
+	int listenmode = 0;
+	int wantlinear = (linear > 0.5f) ? 1 : 0;
+	uint32_t meterinterval = std::max((uint32_t)(srate / METER_RATE), 1U);
+	uint32_t i, n;
+	int k;
 
-        int listen1 = (listen[0] > 0.5f) ? 1 : 0;
-        int listen2 = (listen[1] > 0.5f) ? 1 : 0;
-        int listen3 = (listen[2] > 0.5f) ? 1 : 0;
+	/*
+	 * The linear phase splitter takes over once it matches the current
+	 * crossovers and has a full history, until then the IIR splitter
+	 * keeps playing with no latency and the FIR bank is only fed.
+	 */
+	if (wantlinear) {
+		if (!oldwant)
+			firxover.reset();
+		firxover.update(xover, nbands);
+	}
+	oldwant = wantlinear;
 
-        if (oldxover1 != xover1) {
-		calc_lr4(xover1, 0);
-		calc_lr4(xover1, 1);
-		oldxover1 = xover1;
+	int linearmode = (wantlinear && (oldlinear == 1 || firxover.current())) ? 1 : 0;
+	if (linearmode != oldlinear) {
+		setLatency(linearmode ? firxover.getLatency() : 0);
+		oldlinear = linearmode;
 	}
 
-        if (oldxover2 != xover2) {
-		calc_lr4(xover2, 2);
-		calc_lr4(xover2, 3);
-		oldxover2 = xover2;
+	/*
+	 * The crossover tree splits the lowest band off the remainder at each
+	 * stage. The low and high mixes of a stage are complementary, their
+	 * coefficients add up to c1 = c2 = 0, d = 1, so low + high is the stage
+	 * input exactly rather than an allpass of it. The bands therefore sum
+	 * back to the input for any band count and the lower bands need no
+	 * allpass at the higher crossovers.
+	 */
+	for (k = 0; k < nbands - 1; k++) {
+		if (oldxover[k] != xover[k]) {
+			calc_lr4(xover[k], k);
+			oldxover[k] = xover[k];
+		}
 	}
 
-        for (i = 0; i < frames; ++i) {
-                float tmp1[2], tmp2[2], tmp3[2];
-		float fil1[2], fil2[2], fil3[2], fil4[2];
-		float outL[MAX_COMP+1] = {0.f};
-		float outR[MAX_COMP+1] = {0.f};
-		float inl = sanitize_denormal(inputs[0][i]);
-		float inr = sanitize_denormal(inputs[1][i]);
-		inl = (fabsf(inl) < DANGER) ? inl : 0.f;
-		inr = (fabsf(inr) < DANGER) ? inr : 0.f;
-
-		int listenmode = 0;
-
-		// Interleaved channel processing
-                run_lr4(0, inl, &fil1[0], &fil2[0]);
-                run_lr4(1, inr, &fil1[1], &fil2[1]);
-                run_lr4(2, fil2[0], &fil3[0], &fil4[0]);
-                run_lr4(3, fil2[1], &fil3[1], &fil4[1]);
-
-		pushsample(std::max(fil1[0], fil1[1]), 0);
-		outlevel[0] = sqrt(average[0]);
-		outlevel[0] = (outlevel[0] == 0.f) ? -45.0 : to_dB(outlevel[0]);
-		if (tog1)
-			run_comp(0, fil1[0], fil1[1], &outL[0], &outR[0]);
-
-		tmp1[0] = tog1 ? outL[0] * from_dB(makeup[0]) : fil1[0];
-                tmp1[1] = tog1 ? outR[0] * from_dB(makeup[0]) : fil1[1];
-
-		pushsample(std::max(fil3[0], fil3[1]), 1);
-		outlevel[1] = sqrt(average[1]);
-		outlevel[1] = (outlevel[1] == 0.f) ? -45.0 : to_dB(outlevel[1]);
-		if (tog2)
-			run_comp(1, fil3[0], fil3[1], &outL[1], &outR[1]);
-
-                tmp2[0] = tog2 ? outL[1] * from_dB(makeup[1]) : fil3[0];
-                tmp2[1] = tog2 ? outR[1] * from_dB(makeup[1]) : fil3[1];
-
-		pushsample(std::max(fil4[0], fil4[1]), 2);
-		outlevel[2] = sqrt(average[2]);
-		outlevel[2] = (outlevel[2] == 0.f) ? -45.0 : to_dB(outlevel[2]);
-		if (tog3)
-			run_comp(2, fil4[0], fil4[1], &outL[2], &outR[2]);
-
-                tmp3[0] = tog3 ? outL[2] * from_dB(makeup[2]) : fil4[0];
-                tmp3[1] = tog3 ? outR[2] * from_dB(makeup[2]) : fil4[1];
-
-		outputs[0][i] = outputs[1][i] = 0.f;
-		if (listen1) {
+	// All bands, the linear phase splitter may briefly run a different count
+	for (k = 0; k < MAX_BANDS; k++) {
+		tog[k] = (toggle[k] > 0.5f) ? 1.f : 0.f;
+		width[k] = (6.f * knee[k]) + 0.01;
+		slope[k] = 1.f/ratio[k] - 1.f;
+		attcoef[k] = exp(-1000.f/(attack[k] * srate));
+		relcoef[k] = exp(-1000.f/(release[k] * srate));
+		makeupgain[k] = from_dB(makeup[k]);
+		if (k < nbands && listen[k] > 0.5f)
 			listenmode = 1;
-			outputs[0][i] += outL[0] * tog1*from_dB(makeup[0])
-					+ (1.-tog1) * tmp1[0];
-			outputs[1][i] += outR[0] * tog1*from_dB(makeup[0])
-					+ (1.-tog1) * tmp1[1];
+	}
+
+	for (i = 0; i < frames; i += n) {
+		float bandl[MAX_BANDS][CHUNK], bandr[MAX_BANDS][CHUNK];
+		float inl[CHUNK], inr[CHUNK];
+		float *dstl = &outputs[0][i];
+		float *dstr = &outputs[1][i];
+		int fir = linearmode && firxover.getBands() > 0;
+		int nb = fir ? firxover.getBands() : nbands;
+		uint32_t j;
+
+		// Chunks never straddle an FIR block, where the band count can change
+		n = std::min(frames - i, (uint32_t)CHUNK);
+		if (fir)
+			n = std::min(n, firxover.getRemaining());
+
+		for (j = 0; j < n; j++) {
+			float l = sanitize_denormal(inputs[0][i+j]);
+			float r = sanitize_denormal(inputs[1][i+j]);
+			inl[j] = (fabsf(l) < DANGER) ? l : 0.f;
+			inr[j] = (fabsf(r) < DANGER) ? r : 0.f;
 		}
-		if (listen2) {
-			listenmode = 1;
-			outputs[0][i] += outL[1] * tog2*from_dB(makeup[1])
-					+ (1.-tog2) * tmp2[0];
-			outputs[1][i] += outR[1] * tog2*from_dB(makeup[1])
-					+ (1.-tog2) * tmp2[1];
+
+		if (fir) {
+			for (j = 0; j < n; j++) {
+				const float in[2] = { inl[j], inr[j] };
+				float split[2 * XOVER_MAXBANDS];
+				firxover.process(in, split);
+				for (k = 0; k < nb; k++) {
+					bandl[k][j] = split[k];
+					bandr[k][j] = split[XOVER_MAXBANDS + k];
+				}
+			}
+		} else {
+			for (j = 0; j < n && wantlinear; j++) {
+				const float in[2] = { inl[j], inr[j] };
+				firxover.process(in, NULL);
+			}
+			for (j = 0; j < n; j++) {
+				float l = inl[j];
+				float r = inr[j];
+				// Both channels and both outputs of a stage in one pass
+				for (k = 0; k < nb - 1; k++) {
+					float split[LANES];
+					run_lr4(k, l, r, split);
+					bandl[k][j] = split[LANE_LOW_L];
+					bandr[k][j] = split[LANE_LOW_R];
+					l = split[LANE_HIGH_L];
+					r = split[LANE_HIGH_R];
+				}
+				bandl[nb-1][j] = l;
+				bandr[nb-1][j] = r;
+			}
 		}
-		if (listen3) {
-			listenmode = 1;
-			outputs[0][i] += outL[2] * tog3*from_dB(makeup[2])
-					+ (1.-tog3) * tmp3[0];
-			outputs[1][i] += outR[2] * tog3*from_dB(makeup[2])
-					+ (1.-tog3) * tmp3[1];
+
+		for (k = 0; k < nb; k++) {
+			float bandpeak = 0.f;
+			for (j = 0; j < n; j++) {
+				// The meter follows the signed larger channel, as it always has
+				float m = std::max(bandl[k][j], bandr[k][j]);
+				bandsq[k] += m * m;
+				bandpeak = std::max(bandpeak, std::max(fabsf(bandl[k][j]), fabsf(bandr[k][j])));
+			}
+
+			// Bypassed bands pass through, silent settled bands only need makeup
+			if (!tog[k])
+				continue;
+			if (bandpeak < SILENCE && old_yl[0][k] < SETTLED && old_yl[1][k] < SETTLED) {
+				old_yl[0][k] = old_yl[1][k] = 0.f;
+				gainr[k] = 0.f;
+				for (j = 0; j < n; j++) {
+					bandl[k][j] *= makeupgain[k];
+					bandr[k][j] *= makeupgain[k];
+				}
+				continue;
+			}
+			run_comp(k, bandl[k], bandr[k], n);
 		}
-		if (!listenmode) {
-			outputs[0][i] = tmp1[0] + tmp2[0] + tmp3[0];
-			outputs[1][i] = tmp1[1] + tmp2[1] + tmp3[1];
+
+		for (j = 0; j < n; j++)
+			dstl[j] = dstr[j] = 0.f;
+		for (k = 0; k < nb; k++) {
+			if (listenmode && listen[k] <= 0.5f)
+				continue;
+			for (j = 0; j < n; j++) {
+				dstl[j] += bandl[k][j];
+				dstr[j] += bandr[k][j];
+			}
 		}
-                outputs[0][i] = sanitize_denormal(outputs[0][i]);
-                outputs[1][i] = sanitize_denormal(outputs[1][i]);
-                outputs[0][i] *= from_dB(globalgain);
-                outputs[1][i] *= from_dB(globalgain);
+		for (j = 0; j < n; j++) {
+			dstl[j] = sanitize_denormal(dstl[j]);
+			dstr[j] = sanitize_denormal(dstr[j]);
+			dstl[j] *= from_dB(globalgain);
+			dstr[j] *= from_dB(globalgain);
 
-		maxxL = (fabsf(outputs[0][i]) > maxxL) ? fabsf(outputs[0][i]) : sanitize_denormal(maxxL);
-		maxxR = (fabsf(outputs[1][i]) > maxxR) ? fabsf(outputs[1][i]) : sanitize_denormal(maxxR);
-        }
+			maxxL = (fabsf(dstl[j]) > maxxL) ? fabsf(dstl[j]) : sanitize_denormal(maxxL);
+			maxxR = (fabsf(dstr[j]) > maxxR) ? fabsf(dstr[j]) : sanitize_denormal(maxxR);
+		}
+
+		meterpos += n;
+		if (meterpos >= meterinterval)
+			update_meters(nb);
+	}
 	outl = (maxxL == 0.f) ? -160.f : to_dB(maxxL);
 	outr = (maxxR == 0.f) ? -160.f : to_dB(maxxR);
 }
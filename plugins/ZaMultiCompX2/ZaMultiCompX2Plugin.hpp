@@ -18,22 +18,43 @@
 
 #include "DistrhoPlugin.hpp"
 #include <algorithm>
+#include "../../dsp/ZamFIRCrossover.hpp"
 
 START_NAMESPACE_DISTRHO
 
-#define MAX_FILT 4
-#define MAX_COMP 3
+#define MAX_BANDS 8
+#define MAX_XOVER (MAX_BANDS - 1)
 #define MAX_SAMPLES 480
+#define METER_RATE 100		/* meter updates per second */
 #define STEREOLINK_MAX 1
 #define STEREOLINK_AVERAGE 0
 #define DANGER 100000.f
 #define EPS 1e-20f
+#define CHUNK 64
+#define SILENCE 1e-6f		/* -120 dBFS */
+#define SETTLED 1e-5f		/* dB of gain reduction treated as none */
 
 // -----------------------------------------------------------------------
 
 class ZaMultiCompX2Plugin : public Plugin
 {
 public:
+    // Layout of each per-band parameter block for bands 4 and up
+    enum BandParameters
+    {
+        bandAttack = 0,
+        bandRelease,
+        bandKnee,
+        bandRatio,
+        bandThresh,
+        bandMakeup,
+        bandToggle,
+        bandListen,
+        bandGainR,
+        bandOutputLevel,
+        bandParamCount
+    };
+
     enum Parameters
     {
         paramAttack1 = 0,
@@ -78,7 +99,16 @@ public:
         paramGainR2,
         paramGainR3,
 
-        paramCount
+        paramBands,
+        paramXover3,
+        paramXover4,
+        paramXover5,
+        paramXover6,
+        paramXover7,
+        paramLinear,
+
+        paramBandStart,
+        paramCount = paramBandStart + (MAX_BANDS - 3) * bandParamCount
     };
 
     enum States
@@ -162,38 +192,66 @@ Stereo version of ZaMultiComp, with individual threshold controls for each band
 	        return (20.f*log10(g));
 	}
 
-    void run_comp(int k, float inL, float inR, float *outL, float *outR);
+    void initBandParameter(uint32_t index, Parameter& parameter);
+    float getBandParameter(uint32_t index) const;
+    void setBandParameter(uint32_t index, float value);
+
+    void run_comp(int k, float *l, float *r, uint32_t n);
     void run_limit(float inL, float inR, float *outL, float *outR);
-    void run_lr4(int i, float in, float *outlo, float *outhi);
+    void run_lr4(int i, float inl, float inr, float *out);
     void calc_lr4(float f, int i);
 
     void activate() override;
     void run(const float** inputs, float** outputs, uint32_t frames) override;
 
-	void pushsample(float sample, int k);
+	void update_meters(int nbands);
+
+	/*
+	 * One crossover stage: four SVFs sharing a cutoff, one per lane
+	 * (LANE_LOW_L, LANE_HIGH_L, LANE_LOW_R, LANE_HIGH_R), with the
+	 * per-sample update reduced to multiply-adds so all lanes run as
+	 * one vector operation.
+	 */
+	enum {
+		LANE_LOW_L = 0,
+		LANE_HIGH_L,
+		LANE_LOW_R,
+		LANE_HIGH_R,
+		LANES
+	};
 
-	struct linear_svf {
-		double k;
-		double g;
+	struct linear_svf4 {
+		float a1[LANES], b1[LANES], c1[LANES];
+		float a2[LANES], b2[LANES], c2[LANES];
+		float d[LANES];
 
-		double s[2];
+		float s0[LANES], s1[LANES];
 	};
 
-	struct linear_svf simper[2][MAX_FILT];
-	void linear_svf_set_xover(struct linear_svf *self, float sample_rate, float cutoff, float resonance);
-	void linear_svf_reset(struct linear_svf *self);
-	float run_linear_svf_xover(struct linear_svf *self, float in, float mixlow, float mixhigh);
+	struct linear_svf4 simper[MAX_XOVER];
+	void linear_svf_set_xover(struct linear_svf4 *self, float sample_rate, float cutoff, float resonance);
+	void linear_svf_reset(struct linear_svf4 *self);
     // -------------------------------------------------------------------
 
 private:
-    float attack[MAX_COMP],release[MAX_COMP],knee[MAX_COMP],ratio[MAX_COMP],thresdb[MAX_COMP],makeup[MAX_COMP],globalgain,stereodet;
-    float gainr[MAX_COMP],toggle[MAX_COMP],listen[MAX_COMP],maxL,maxR,outl,outr,xover1,xover2;
-    float old_yl[2][MAX_COMP], old_y1[2][MAX_COMP], old_yg[2][MAX_COMP];
+    float attack[MAX_BANDS],release[MAX_BANDS],knee[MAX_BANDS],ratio[MAX_BANDS],thresdb[MAX_BANDS],makeup[MAX_BANDS],globalgain,stereodet;
+    float gainr[MAX_BANDS],toggle[MAX_BANDS],listen[MAX_BANDS],maxL,maxR,outl,outr,xover[MAX_XOVER],bands,linear;
+    float outlevel[MAX_BANDS];
+    float oldxover[MAX_XOVER];
+    int oldlinear, oldwant;
+    ZamFIRCrossover firxover;
+
+    // Per-band compressor state and per-block coefficients, band contiguous
+    float old_yl[2][MAX_BANDS], old_y1[2][MAX_BANDS], old_yg[2][MAX_BANDS];
     float old_ll[2], old_l1[2];
-    float outlevel[3];
-    float average[3];
-    int pos[3];
-    float oldxover1, oldxover2;
+    float attcoef[MAX_BANDS], relcoef[MAX_BANDS], width[MAX_BANDS], slope[MAX_BANDS];
+    float makeupgain[MAX_BANDS], tog[MAX_BANDS];
+    float average[MAX_BANDS];
+    int pos[MAX_BANDS];
+
+    // Accumulated over one metering interval
+    float bandsq[MAX_BANDS];
+    uint32_t meterpos;
     bool resetl;
     bool resetr;
 };
@@ -296,6 +296,10 @@ ZaMultiCompX2UI::ZaMultiCompX2UI()
     fCanvasArea.setPos(430, 42);
     fCanvasArea.setSize(145, 145);
 
+    memset(grhist, 0, sizeof(grhist));
+    grhistpos = 0;
+    grquiet = GR_HISTORY + 1;
+
     int i,k;
 
     for (k = 0; k < MAX_COMP; ++k) {
@@ -1122,10 +1126,49 @@ glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 	glEnd();
 	}
     }
+
+    // scrolling gain reduction, newest on the right, hanging from the top
+    glLineWidth(1);
+    for (k = 0; k < MAX_COMP; ++k) {
+        if (!flip[k])
+            continue;
+        glColor4f((k==0)?1.f:0.235f, (k==1)?1.f:0.235f, (k==2)?1.f:0.235f, 0.5f);
+        glBegin(GL_LINE_STRIP);
+        for (i = 0; i < GR_HISTORY; ++i) {
+            float gr = grhist[k][(grhistpos + i) % GR_HISTORY];
+            gr = (gr > GR_RANGE) ? 1.f : (gr < 0.f) ? 0.f : gr / GR_RANGE;
+            glVertex2f(fCanvasArea.getX() + i, fCanvasArea.getY() + gr * fCanvasArea.getHeight());
+        }
+        glEnd();
+    }
     // reset color
     glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 }
 
+/*
+ * The gain reduction outputs are sampled into the history once per idle
+ * tick. Once a whole history of silence has scrolled past there is
+ * nothing left to move, so repainting stops until reduction comes back.
+ */
+void ZaMultiCompX2UI::uiIdle()
+{
+    bool active = false;
+
+    for (int k = 0; k < MAX_COMP; ++k) {
+        grhist[k][grhistpos] = fLedRedValue[k];
+        if (fLedRedValue[k] > 0.f)
+            active = true;
+    }
+    grhistpos = (grhistpos + 1) % GR_HISTORY;
+
+    if (active)
+        grquiet = 0;
+    else if (grquiet <= GR_HISTORY)
+        grquiet++;
+    if (grquiet <= GR_HISTORY)
+        repaint();
+}
+
 // -----------------------------------------------------------------------
 
 UI* createUI()
@@ -26,6 +26,8 @@
 
 #define COMPOINTS 1000
 #define MAX_COMP 3
+#define GR_HISTORY 145	/* one point per pixel of the canvas */
+#define GR_RANGE 24.f	/* dB of gain reduction shown */
 
 using DGL::Image;
 using DGL::ZamKnob;
@@ -65,6 +67,7 @@ protected:
     void imageSwitchClicked(ImageSwitch* toggle, bool down) override;
 
     void onDisplay() override;
+    void uiIdle() override;
 
 inline double
 to_dB(double g) {
@@ -120,6 +123,8 @@ private:
     float dotx[MAX_COMP];
     float doty[MAX_COMP];
     float outlevel[3];
+    float grhist[MAX_COMP][GR_HISTORY];
+    int grhistpos, grquiet;
 };
 
 // -----------------------------------------------------------------------
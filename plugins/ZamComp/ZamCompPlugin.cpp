@@ -125,6 +125,24 @@ void ZamCompPlugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.min = -45.0f;
         parameter.ranges.max = 20.0f;
         break;
+    case paramDetect:
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.name       = "Detection (Peak/RMS/True Peak)";
+        parameter.symbol     = "detect";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 2.0f;
+        break;
+    case paramAutoRelease:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "Auto Release";
+        parameter.symbol     = "autorel";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
     }
 }
 
@@ -168,6 +186,8 @@ void ZamCompPlugin::loadProgram(uint32_t index)
 		slewfactor = 1.0;
 		outlevel = -45.0;
 		sidechain = 0.0;
+		detect = 0.0;
+		autorelease = 0.0;
 		break;
 	case 1:
 		attack = 10.0;
@@ -180,6 +200,8 @@ void ZamCompPlugin::loadProgram(uint32_t index)
 		slewfactor = 20.0;
 		outlevel = -45.0;
 		sidechain = 0.0;
+		detect = 0.0;
+		autorelease = 0.0;
 		break;
 	case 2:
 		attack = 50.0;
@@ -192,6 +214,8 @@ void ZamCompPlugin::loadProgram(uint32_t index)
 		slewfactor = 1.0;
 		outlevel = -45.0;
 		sidechain = 0.0;
+		detect = 0.0;
+		autorelease = 0.0;
 		break;
 	}
 
@@ -235,6 +259,12 @@ float ZamCompPlugin::getParameterValue(uint32_t index) const
     case paramOutputLevel:
         return outlevel;
         break;
+    case paramDetect:
+        return detect;
+        break;
+    case paramAutoRelease:
+        return autorelease;
+        break;
     default:
         return 0.0f;
     }
@@ -274,6 +304,12 @@ void ZamCompPlugin::setParameterValue(uint32_t index, float value)
     case paramOutputLevel:
         outlevel = value;
         break;
+    case paramDetect:
+        detect = value;
+        break;
+    case paramAutoRelease:
+        autorelease = value;
+        break;
     }
 }
 
@@ -284,29 +320,50 @@ void ZamCompPlugin::activate()
 {
     gainred = 0.0f;
     outlevel = -45.0f;
-    oldL_yl = oldL_y1 = oldL_yg = 0.f;
+    oldL_yl = oldL_y1 = oldL_yg = oldL_ys = 0.f;
+    detector.reset();
+    envtable.init(getSampleRate());
 }
 
+/*
+ * Auto release runs a second, slow envelope off the gain reduction that
+ * charges over AUTOREL_CHARGE release times and lets go over AUTOREL_SLOW
+ * release times. The larger of the two is applied, so short peaks recover
+ * at the release setting while sustained compression lets go slowly.
+ *
+ * All smoothing coefficients come from envtable once per block.
+ */
+
 void ZamCompPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
 	float srate = getSampleRate();
 	float width = (6.f * knee) + 0.01;
 	float slewwidth = 1.8f;
         float cdb=0.f;
-        float attack_coeff = exp(-1000.f/(attack * srate));
-        float release_coeff = exp(-1000.f/(release * srate));
+        float attack_coeff = envtable.coeff(attack);
+        float release_coeff = envtable.coeff(release);
+        float attslew_coeff = envtable.coeff(attack + 2.0*(slewfactor - 1));
+        float charge_coeff = envtable.coeff(release * AUTOREL_CHARGE);
+        float slow_coeff = envtable.coeff(release * AUTOREL_SLOW);
+	bool autorel = (autorelease < 0.5) ? false : true;
 
         int attslew = 0;
 	float max = 0.f;
 	float lgaininp = 0.f;
 	float Lgain = 1.f;
-        float Lxg, Lxl, Lyg, Lyl;
+        float Lxg, Lxl, Lyg, Lyl, Lys;
         float checkwidth = 0.f;
 	bool usesidechain = (sidechain < 0.5) ? false : true;
 	uint32_t i;
 	float ingain;
 	float in0;
 	float in1;
+	float level;
+	int detectmode = (int)detect;
+
+	// RMS integrates over 10ms, peak modes are instantaneous
+	detector.setMode(detectmode);
+	detector.setWindow((detectmode == ZamDetector::DETECT_RMS) ? (uint32_t)(0.01f * srate) : 1);
 
         for (i = 0; i < frames; i++) {
                 in0 = inputs[0][i];
@@ -314,7 +371,8 @@ void ZamCompPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 		ingain = usesidechain ? in1 : in0;
                 attslew = 0;
 		Lyg = 0.f;
-		Lxg = (ingain==0.f) ? -160.f : to_dB(fabsf(ingain));
+		level = detector.process(ingain);
+		Lxg = (level==0.f) ? -160.f : to_dB(level);
                 Lxg = sanitize_denormal(Lxg);
 
                 Lyg = Lxg + (1.f/ratio-1.f)*(Lxg-thresdb+width/2.f)*(Lxg-thresdb+width/2.f)/(2.f*width);
@@ -335,7 +393,7 @@ void ZamCompPlugin::run(const float** inputs, float** outputs, uint32_t frames)
                         Lyg = sanitize_denormal(Lyg);
                 }
 
-                attack_coeff = attslew ? exp(-1000.f/((attack + 2.0*(slewfactor - 1)) * srate)) : attack_coeff;
+                attack_coeff = attslew ? attslew_coeff : attack_coeff;
                 // Don't slew on release
 
                 Lxl = Lxg - Lyg;
@@ -351,10 +409,21 @@ void ZamCompPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 		}
                 Lyl = sanitize_denormal(Lyl);
 
-                cdb = -Lyl;
+		if (autorel) {
+			if (Lyl > oldL_ys) {
+				Lys = charge_coeff * oldL_ys + (1.f-charge_coeff)*Lyl;
+			} else {
+				Lys = slow_coeff * oldL_ys + (1.f-slow_coeff)*Lyl;
+			}
+			oldL_ys = sanitize_denormal(Lys);
+			cdb = -fmaxf(Lyl, oldL_ys);
+		} else {
+			oldL_ys = Lyl;
+			cdb = -Lyl;
+		}
                 Lgain = from_dB(cdb);
 
-                gainred = Lyl;
+                gainred = -cdb;
 
 		lgaininp = in0 * Lgain;
                 outputs[0][i] = lgaininp * from_dB(makeup);
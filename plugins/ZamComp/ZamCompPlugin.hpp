@@ -17,6 +17,12 @@
 #define ZAMCOMPPLUGIN_HPP_INCLUDED
 
 #include "DistrhoPlugin.hpp"
+#include "../../dsp/ZamDetector.hpp"
+#include "../../dsp/ZamEnvTable.hpp"
+
+/* Auto release slow stage, as multiples of the release time */
+#define AUTOREL_CHARGE 4.f
+#define AUTOREL_SLOW 8.f
 
 START_NAMESPACE_DISTRHO
 
@@ -37,6 +43,8 @@ public:
         paramSidechain,
         paramGainRed,
         paramOutputLevel,
+        paramDetect,
+        paramAutoRelease,
         paramCount
     };
 
@@ -121,8 +129,10 @@ protected:
     // -------------------------------------------------------------------
 
 private:
-    float attack,release,knee,ratio,thresdb,makeup,gainred,outlevel,slewfactor,sidechain; //parameters
-    float oldL_yl, oldL_y1, oldL_yg;
+    float attack,release,knee,ratio,thresdb,makeup,gainred,outlevel,slewfactor,sidechain,detect,autorelease; //parameters
+    float oldL_yl, oldL_y1, oldL_yg, oldL_ys;
+    ZamDetector detector;
+    ZamEnvTable envtable;
 };
 
 // -----------------------------------------------------------------------
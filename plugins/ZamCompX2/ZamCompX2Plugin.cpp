@@ -134,6 +134,15 @@ void ZamCompX2Plugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.min = -45.0f;
         parameter.ranges.max = 20.0f;
         break;
+    case paramDetect:
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.name       = "Detection (Peak/RMS/True Peak)";
+        parameter.symbol     = "detect";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 2.0f;
+        break;
     }
 }
 
@@ -177,6 +186,7 @@ void ZamCompX2Plugin::loadProgram(uint32_t index)
 		slewfactor = 1.0;
 		sidechain = 0.0;
 		stereodet = 0.0;
+		detect = 0.0;
 		outlevel = -45.0;
 		break;
 	case 1:
@@ -190,6 +200,7 @@ void ZamCompX2Plugin::loadProgram(uint32_t index)
 		slewfactor = 20.0;
 		sidechain = 0.0;
 		stereodet = 1.0;
+		detect = 0.0;
 		outlevel = -45.0;
 		break;
 	case 2:
@@ -203,6 +214,7 @@ void ZamCompX2Plugin::loadProgram(uint32_t index)
 		slewfactor = 1.0;
 		sidechain = 0.0;
 		stereodet = 1.0;
+		detect = 0.0;
 		outlevel = -45.0;
 		break;
 	}
@@ -250,6 +262,9 @@ float ZamCompX2Plugin::getParameterValue(uint32_t index) const
     case paramOutputLevel:
         return outlevel;
         break;
+    case paramDetect:
+        return detect;
+        break;
     default:
         return 0.0f;
     }
@@ -292,6 +307,9 @@ void ZamCompX2Plugin::setParameterValue(uint32_t index, float value)
     case paramOutputLevel:
         outlevel = value;
         break;
+    case paramDetect:
+        detect = value;
+        break;
     }
 }
 
@@ -300,139 +318,114 @@ void ZamCompX2Plugin::setParameterValue(uint32_t index, float value)
 
 void ZamCompX2Plugin::activate()
 {
+    int c;
+
     gainred = 0.0f;
     outlevel = -45.0f;
-    oldL_yl = oldL_y1 = oldR_yl = oldR_y1 = oldL_yg = oldR_yg = 0.f;
+    for (c = 0; c < LANES; c++) {
+        old_yl[c] = old_yg[c] = 0.f;
+        detector[c].reset();
+    }
 }
 
+/*
+ * L and R go through the curve, the smoother and the gain stage as the
+ * two lanes of short fixed length loops, which the compiler turns into
+ * one vector operation per step. When the channels are linked the lanes
+ * usually hold the same envelope, so the gain is converted only once.
+ */
 void ZamCompX2Plugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
 	float srate = getSampleRate();
 	float width = (6.f * knee) + 0.01;
 	float slewwidth = 1.8f;
-        float cdb=0.f;
         float attack_coeff = exp(-1000.f/(attack * srate));
         float release_coeff = exp(-1000.f/(release * srate));
+	float makeupgain = from_dB(makeup);
 	int stereo = (stereodet < 0.5) ? STEREOLINK_AVERAGE : STEREOLINK_MAX;
 	bool usesidechain = (sidechain < 0.5) ? false : true;
 
         int attslew = 0;
-	float max = 0.f;
-	float lgaininp = 0.f;
-	float rgaininp = 0.f;
-	float Lgain = 1.f;
-        float Rgain = 1.f;
-        float Lxg, Lxl, Lyg, Lyl;
-        float Rxg, Rxl, Ryg, Ryl;
-        float checkwidth = 0.f;
+	float max = 0.f, outmax;
+	float in[LANES], level[LANES], gain[LANES], out[LANES];
+	float xg[LANES], yg[LANES], xl[LANES], yl[LANES];
+	float d, link;
 	uint32_t i;
-	float in0;
-	float in1;
-	float ingain;
+	int c;
+	int detectmode = (int)detect;
+	uint32_t detectwin = (detectmode == ZamDetector::DETECT_RMS) ? (uint32_t)(0.01f * srate) : 1;
+
+	// RMS integrates over 10ms, peak modes are instantaneous
+	for (c = 0; c < LANES; c++) {
+		detector[c].setMode(detectmode);
+		detector[c].setWindow(detectwin);
+	}
 
         for (i = 0; i < frames; i++) {
-                in0 = inputs[0][i];
-		in1 = inputs[1][i];
-		ingain = usesidechain ? inputs[2][i] : fmaxf(in0, in1);
+		in[LANE_L] = inputs[0][i];
+		in[LANE_R] = inputs[1][i];
                 attslew = 0;
-		Lyg = Ryg = 0.f;
+
                 if (usesidechain) {
-			Lxg = (ingain==0.f) ? -160.f : to_dB(fabsf(ingain));
-                	Rxg = Lxg;
+			level[LANE_L] = level[LANE_R] = detector[0].process(inputs[2][i]);
+			xg[LANE_L] = xg[LANE_R] = (level[LANE_L]==0.f) ? -160.f : to_dB(level[LANE_L]);
 		} else {
-			Lxg = (in0==0.f) ? -160.f : to_dB(fabsf(in0));
-			Rxg = (in1==0.f) ? -160.f : to_dB(fabsf(in1));
+			for (c = 0; c < LANES; c++)
+				level[c] = detector[c].process(in[c]);
+			for (c = 0; c < LANES; c++)
+				xg[c] = (level[c]==0.f) ? -160.f : to_dB(level[c]);
 		}
-                Lxg = sanitize_denormal(Lxg);
-                Rxg = sanitize_denormal(Rxg);
-
-                Lyg = Lxg + (1.f/ratio-1.f)*(Lxg-thresdb+width/2.f)*(Lxg-thresdb+width/2.f)/(2.f*width);
-                Ryg = Rxg + (1.f/ratio-1.f)*(Rxg-thresdb+width/2.f)*(Rxg-thresdb+width/2.f)/(2.f*width);
-
-		checkwidth = 2.f*fabsf(Lxg-thresdb);
-                if (2.f*(Lxg-thresdb) < -width) {
-                        Lyg = Lxg;
-                } else if (checkwidth <= width) {
-			Lyg = thresdb + (Lxg-thresdb)/ratio;
-			Lyg = sanitize_denormal(Lyg);
-			if (checkwidth <= slewwidth) {
-				if (Lyg >= oldL_yg) {
-					attslew = 1;
-				}
-			}
-                } else if (2.f*(Lxg-thresdb) > width) {
-                        Lyg = thresdb + (Lxg-thresdb)/ratio;
-                        Lyg = sanitize_denormal(Lyg);
-                }
 
-		checkwidth = 2.f*fabsf(Rxg-thresdb);
-                if (2.f*(Rxg-thresdb) < -width) {
-                        Ryg = Rxg;
-                } else if (checkwidth <= width) {
-			Ryg = thresdb + (Rxg-thresdb)/ratio;
-			Ryg = sanitize_denormal(Ryg);
-			if (checkwidth <= slewwidth) {
-				if (Ryg >= oldR_yg) {
-					attslew = 1;
-				}
-			}
-                } else if (2.f*(Rxg-thresdb) > width) {
-                        Ryg = thresdb + (Rxg-thresdb)/ratio;
-                        Ryg = sanitize_denormal(Ryg);
-                }
+		for (c = 0; c < LANES; c++) {
+			xg[c] = sanitize_denormal(xg[c]);
+			d = 2.f*(xg[c]-thresdb);
+			yg[c] = (d < -width) ? xg[c] : sanitize_denormal(thresdb + (xg[c]-thresdb)/ratio);
+			if (fabsf(d) <= width && fabsf(d) <= slewwidth && yg[c] >= old_yg[c])
+				attslew = 1;
+		}
 
                 attack_coeff = attslew ? exp(-1000.f/((attack + 2.0*(slewfactor - 1)) * srate)) : attack_coeff;
                 // Don't slew on release
 
                 if (stereo == STEREOLINK_UNCOUPLED) {
-                        Lxl = Lxg - Lyg;
-                        Rxl = Rxg - Ryg;
-                } else if (stereo == STEREOLINK_MAX) {
-                        Lxl = Rxl = fmaxf(Lxg - Lyg, Rxg - Ryg);
+			for (c = 0; c < LANES; c++)
+				xl[c] = xg[c] - yg[c];
                 } else {
-                        Lxl = Rxl = (Lxg - Lyg + Rxg - Ryg) / 2.f;
+			if (stereo == STEREOLINK_MAX)
+				link = fmaxf(xg[LANE_L] - yg[LANE_L], xg[LANE_R] - yg[LANE_R]);
+			else
+				link = (xg[LANE_L] - yg[LANE_L] + xg[LANE_R] - yg[LANE_R]) / 2.f;
+			xl[LANE_L] = xl[LANE_R] = link;
                 }
 
-                oldL_yl = sanitize_denormal(oldL_yl);
-		if (Lxl < oldL_yl) {
-			Lyl = release_coeff * oldL_yl + (1.f-release_coeff)*Lxl;
-		} else if (Lxl > oldL_yl) {
-			Lyl = attack_coeff * oldL_yl+(1.f-attack_coeff)*Lxl;
-		} else {
-			Lyl = Lxl;
+		for (c = 0; c < LANES; c++) {
+			old_yl[c] = sanitize_denormal(old_yl[c]);
+			if (xl[c] < old_yl[c]) {
+				yl[c] = release_coeff * old_yl[c] + (1.f-release_coeff)*xl[c];
+			} else if (xl[c] > old_yl[c]) {
+				yl[c] = attack_coeff * old_yl[c] + (1.f-attack_coeff)*xl[c];
+			} else {
+				yl[c] = xl[c];
+			}
+			yl[c] = sanitize_denormal(yl[c]);
 		}
-                Lyl = sanitize_denormal(Lyl);
 
-                cdb = -Lyl;
-                Lgain = from_dB(cdb);
+		gain[LANE_L] = from_dB(-yl[LANE_L]);
+		gain[LANE_R] = (yl[LANE_R] == yl[LANE_L]) ? gain[LANE_L] : from_dB(-yl[LANE_R]);
 
-                gainred = Lyl;
+		for (c = 0; c < LANES; c++)
+			out[c] = in[c] * gain[c] * makeupgain;
+		outmax = fabsf(fmaxf(out[LANE_L], out[LANE_R]));
+		max = (outmax > max) ? outmax : sanitize_denormal(max);
+                outputs[0][i] = out[LANE_L];
+                outputs[1][i] = out[LANE_R];
 
-                oldR_y1 = sanitize_denormal(oldR_y1);
-		if (Rxl < oldR_yl) {
-			Ryl = release_coeff * oldR_yl + (1.f-release_coeff)*Rxl;
-		} else if (Rxl > oldR_yl) {
-			Ryl = attack_coeff * oldR_yl+(1.f-attack_coeff)*Rxl;
-		} else {
-			Ryl = Rxl;
+		for (c = 0; c < LANES; c++) {
+			old_yl[c] = yl[c];
+			old_yg[c] = yg[c];
 		}
-                Ryl = sanitize_denormal(Ryl);
-
-                cdb = -Ryl;
-                Rgain = from_dB(cdb);
-
-		lgaininp = in0 * Lgain;
-		rgaininp = in1 * Rgain;
-                outputs[0][i] = lgaininp * from_dB(makeup);
-                outputs[1][i] = rgaininp * from_dB(makeup);
-
-		max = (fabsf(fmaxf(outputs[0][i], outputs[1][i])) > max) ? fabsf(fmaxf(outputs[0][i], outputs[1][i])) : sanitize_denormal(max);
-
-                oldL_yl = Lyl;
-                oldR_yl = Ryl;
-                oldL_yg = Lyg;
-                oldR_yg = Ryg;
         }
+	gainred = old_yl[LANE_L];
 	outlevel = (max == 0.f) ? -45.f : to_dB(max); // relative to - thresdb;
     }
 
@@ -21,6 +21,7 @@
 #define STEREOLINK_UNCOUPLED 2
 
 #include "DistrhoPlugin.hpp"
+#include "../../dsp/ZamDetector.hpp"
 
 START_NAMESPACE_DISTRHO
 
@@ -42,6 +43,7 @@ public:
 	paramSidechain,
         paramGainRed,
         paramOutputLevel,
+	paramDetect,
         paramCount
     };
 
@@ -126,8 +128,12 @@ protected:
     // -------------------------------------------------------------------
 
 private:
-    float attack,release,knee,ratio,thresdb,makeup,gainred,outlevel,sidechain,stereodet,slewfactor; //parameters
-    float oldL_yl, oldL_y1, oldR_yl, oldR_y1, oldL_yg, oldR_yg;
+    /* L and R run as two lanes of the same loops in run() */
+    enum { LANE_L = 0, LANE_R, LANES };
+
+    float attack,release,knee,ratio,thresdb,makeup,gainred,outlevel,sidechain,stereodet,slewfactor,detect; //parameters
+    float old_yl[LANES], old_yg[LANES];
+    ZamDetector detector[LANES];
 };
 
 // -----------------------------------------------------------------------
@@ -0,0 +1,509 @@
+/*
+ * ZamCompX8 multichannel compressor
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#include "ZamCompX8Plugin.hpp"
+#include <string.h>
+
+START_NAMESPACE_DISTRHO
+
+// -----------------------------------------------------------------------
+
+ZamCompX8Plugin::ZamCompX8Plugin()
+    : Plugin(paramCount, 3, 0)
+{
+    // set default values
+    loadProgram(0);
+}
+
+// -----------------------------------------------------------------------
+// Init
+
+void ZamCompX8Plugin::initParameter(uint32_t index, Parameter& parameter)
+{
+    switch (index)
+    {
+    case paramAttack:
+        parameter.hints      = kParameterIsAutomable;
+        parameter.name       = "Attack";
+        parameter.symbol     = "att";
+        parameter.unit       = "ms";
+        parameter.ranges.def = 10.0f;
+        parameter.ranges.min = 0.1f;
+        parameter.ranges.max = 100.0f;
+        break;
+    case paramRelease:
+        parameter.hints      = kParameterIsAutomable;
+        parameter.name       = "Release";
+        parameter.symbol     = "rel";
+        parameter.unit       = "ms";
+        parameter.ranges.def = 80.0f;
+        parameter.ranges.min = 1.0f;
+        parameter.ranges.max = 500.0f;
+        break;
+    case paramKnee:
+        parameter.hints      = kParameterIsAutomable;
+        parameter.name       = "Knee";
+        parameter.symbol     = "kn";
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 8.0f;
+        break;
+    case paramRatio:
+        parameter.hints      = kParameterIsAutomable | kParameterIsLogarithmic;
+        parameter.name       = "Ratio";
+        parameter.symbol     = "rat";
+        parameter.unit       = " ";
+        parameter.ranges.def = 4.0f;
+        parameter.ranges.min = 1.0f;
+        parameter.ranges.max = 20.0f;
+        break;
+    case paramThresh:
+        parameter.hints      = kParameterIsAutomable;
+        parameter.name       = "Threshold";
+        parameter.symbol     = "thr";
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = -80.0f;
+        parameter.ranges.max = 0.0f;
+        break;
+    case paramMakeup:
+        parameter.hints      = kParameterIsAutomable;
+        parameter.name       = "Makeup";
+        parameter.symbol     = "mak";
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 30.0f;
+        break;
+    case paramSlew:
+        parameter.hints      = kParameterIsAutomable;
+        parameter.name       = "Slew";
+        parameter.symbol     = "slew";
+        parameter.unit       = " ";
+        parameter.ranges.def = 1.0f;
+        parameter.ranges.min = 1.0f;
+        parameter.ranges.max = 150.0f;
+        break;
+    case paramSidechain:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "Sidechain";
+        parameter.symbol     = "sidechain";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    case paramLink:
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.name       = "Link (Average/Max/Per-channel)";
+        parameter.symbol     = "link";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 2.0f;
+        break;
+    case paramChannels:
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.name       = "Channels";
+        parameter.symbol     = "channels";
+        parameter.unit       = " ";
+        parameter.ranges.def = MAX_CHANNELS;
+        parameter.ranges.min = 1.0f;
+        parameter.ranges.max = MAX_CHANNELS;
+        break;
+    case paramDetect:
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.name       = "Detection (Peak/RMS/True Peak)";
+        parameter.symbol     = "detect";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 2.0f;
+        break;
+    case paramGainRed:
+        parameter.hints      = kParameterIsOutput;
+        parameter.name       = "Gain Reduction";
+        parameter.symbol     = "gr";
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 20.0f;
+        break;
+    case paramOutputLevel:
+        parameter.hints      = kParameterIsOutput;
+        parameter.name       = "Output Level";
+        parameter.symbol     = "outlevel";
+        parameter.unit       = "dB";
+        parameter.ranges.def = -45.0f;
+        parameter.ranges.min = -45.0f;
+        parameter.ranges.max = 20.0f;
+        break;
+    }
+}
+
+void ZamCompX8Plugin::initAudioPort(bool input, uint32_t index, AudioPort& port)
+{
+	Plugin::initAudioPort(input, index, port);
+
+	if ((index == MAX_CHANNELS) && input) {
+		port.hints |= kAudioPortIsSidechain;
+		port.name = "Sidechain Input";
+		port.symbol = "sidechain_in";
+	}
+}
+
+void ZamCompX8Plugin::initProgramName(uint32_t index, String& programName)
+{
+	switch(index) {
+	case 0:
+		programName = "Zero";
+		break;
+	case 1:
+		programName = "PoppySnare";
+		break;
+	case 2:
+		programName = "VocalLeveller";
+		break;
+	}
+}
+
+void ZamCompX8Plugin::loadProgram(uint32_t index)
+{
+	switch(index) {
+	case 0:
+		attack = 10.0;
+		release = 80.0;
+		knee = 0.0;
+		ratio = 4.0;
+		thresdb = 0.0;
+		makeup = 0.0;
+		gainred = 0.0;
+		slewfactor = 1.0;
+		sidechain = 0.0;
+		link = LINK_AVERAGE;
+		channels = MAX_CHANNELS;
+		detect = 0.0;
+		outlevel = -45.0;
+		break;
+	case 1:
+		attack = 10.0;
+		release = 10.0;
+		knee = 1.0;
+		ratio = 5.0;
+		thresdb = -18.0;
+		makeup = 6.0;
+		gainred = 0.0;
+		slewfactor = 20.0;
+		sidechain = 0.0;
+		link = LINK_MAX;
+		channels = MAX_CHANNELS;
+		detect = 0.0;
+		outlevel = -45.0;
+		break;
+	case 2:
+		attack = 50.0;
+		release = 400.0;
+		knee = 8.0;
+		ratio = 5.0;
+		thresdb = -16.0;
+		makeup = 9.0;
+		gainred = 0.0;
+		slewfactor = 1.0;
+		sidechain = 0.0;
+		link = LINK_MAX;
+		channels = MAX_CHANNELS;
+		detect = 0.0;
+		outlevel = -45.0;
+		break;
+	}
+
+	activate();
+}
+
+// -----------------------------------------------------------------------
+// Internal data
+
+float ZamCompX8Plugin::getParameterValue(uint32_t index) const
+{
+    switch (index)
+    {
+    case paramAttack:
+        return attack;
+        break;
+    case paramRelease:
+        return release;
+        break;
+    case paramKnee:
+        return knee;
+        break;
+    case paramRatio:
+        return ratio;
+        break;
+    case paramThresh:
+        return thresdb;
+        break;
+    case paramMakeup:
+        return makeup;
+        break;
+    case paramSlew:
+        return slewfactor;
+        break;
+    case paramSidechain:
+        return sidechain;
+        break;
+    case paramLink:
+        return link;
+        break;
+    case paramChannels:
+        return channels;
+        break;
+    case paramDetect:
+        return detect;
+        break;
+    case paramGainRed:
+        return gainred;
+        break;
+    case paramOutputLevel:
+        return outlevel;
+        break;
+    default:
+        return 0.0f;
+    }
+}
+
+void ZamCompX8Plugin::setParameterValue(uint32_t index, float value)
+{
+    switch (index)
+    {
+    case paramAttack:
+        attack = value;
+        break;
+    case paramRelease:
+        release = value;
+        break;
+    case paramKnee:
+        knee = value;
+        break;
+    case paramRatio:
+        ratio = value;
+        break;
+    case paramThresh:
+        thresdb = value;
+        break;
+    case paramMakeup:
+        makeup = value;
+        break;
+    case paramSlew:
+        slewfactor = value;
+        break;
+    case paramSidechain:
+        sidechain = value;
+        break;
+    case paramLink:
+        link = value;
+        break;
+    case paramChannels:
+        channels = value;
+        break;
+    case paramDetect:
+        detect = value;
+        break;
+    case paramGainRed:
+        gainred = value;
+        break;
+    case paramOutputLevel:
+        outlevel = value;
+        break;
+    }
+}
+
+// -----------------------------------------------------------------------
+// Process
+
+void ZamCompX8Plugin::activate()
+{
+    int c;
+
+    gainred = 0.0f;
+    outlevel = -45.0f;
+    for (c = 0; c < MAX_CHANNELS; c++) {
+        old_yl[c] = old_yg[c] = 0.f;
+        detector[c].reset();
+    }
+}
+
+/*
+ * Same curve and envelope as ZamCompX2, generalised to N channels.
+ * Apart from the detectors, which keep a window of history each, every
+ * step below is a loop across the channel arrays with no cross-channel
+ * dependency except the link reduction. Linked and sidechained channels
+ * share one envelope, so it is smoothed and converted to a gain once per
+ * sample and only the multiply runs on every channel.
+ */
+void ZamCompX8Plugin::run(const float** inputs, float** outputs, uint32_t frames)
+{
+	float srate = getSampleRate();
+	float width = (6.f * knee) + 0.01;
+	float slewwidth = 1.8f;
+        float attack_coeff = exp(-1000.f/(attack * srate));
+        float release_coeff = exp(-1000.f/(release * srate));
+	float makeupgain = from_dB(makeup);
+	int linkmode = (int)link;
+	int nch = (int)channels;
+	bool usesidechain = (sidechain < 0.5) ? false : true;
+	bool shared = usesidechain || linkmode != LINK_UNCOUPLED;
+
+        int attslew = 0;
+	float max = 0.f;
+	float level, xlink, d, out, gain;
+	uint32_t i;
+	int c, ncurve;
+	int detectmode = (int)detect;
+	uint32_t detectwin = (detectmode == ZamDetector::DETECT_RMS) ? (uint32_t)(0.01f * srate) : 1;
+
+	if (nch < 1)
+		nch = 1;
+	if (nch > MAX_CHANNELS)
+		nch = MAX_CHANNELS;
+
+	// Channels beyond the active count pass through untouched
+	for (c = nch; c < MAX_CHANNELS; c++) {
+		if (outputs[c] != inputs[c])
+			memcpy(outputs[c], inputs[c], frames * sizeof(float));
+	}
+
+	// RMS integrates over 10ms, peak modes are instantaneous
+	for (c = 0; c < nch; c++) {
+		detector[c].setMode(detectmode);
+		detector[c].setWindow(detectwin);
+	}
+
+	// A sidechain gives every channel the same curve, work it out once
+	ncurve = usesidechain ? 1 : nch;
+
+        for (i = 0; i < frames; i++) {
+                attslew = 0;
+                if (usesidechain) {
+			xg[0] = detector[0].process(inputs[MAX_CHANNELS][i]);
+		} else {
+			for (c = 0; c < nch; c++)
+				xg[c] = detector[c].process(inputs[c][i]);
+		}
+
+		for (c = 0; c < ncurve; c++) {
+			xg[c] = (xg[c]==0.f) ? -160.f : to_dB(xg[c]);
+			xg[c] = sanitize_denormal(xg[c]);
+		}
+
+		for (c = 0; c < ncurve; c++) {
+			d = 2.f*(xg[c]-thresdb);
+			yg[c] = (d < -width) ? xg[c] : sanitize_denormal(thresdb + (xg[c]-thresdb)/ratio);
+			if (fabsf(d) <= width && fabsf(d) <= slewwidth && yg[c] >= old_yg[c])
+				attslew = 1;
+			xl[c] = xg[c] - yg[c];
+		}
+
+                attack_coeff = attslew ? exp(-1000.f/((attack + 2.0*(slewfactor - 1)) * srate)) : attack_coeff;
+                // Don't slew on release
+
+		if (shared) {
+			if (usesidechain) {
+				xlink = xl[0];
+			} else if (linkmode == LINK_MAX) {
+				xlink = xl[0];
+				for (c = 1; c < nch; c++)
+					xlink = fmaxf(xlink, xl[c]);
+			} else {
+				xlink = 0.f;
+				for (c = 0; c < nch; c++)
+					xlink += xl[c];
+				xlink /= nch;
+			}
+
+			old_yl[0] = sanitize_denormal(old_yl[0]);
+			if (xlink < old_yl[0]) {
+				level = release_coeff * old_yl[0] + (1.f-release_coeff)*xlink;
+			} else if (xlink > old_yl[0]) {
+				level = attack_coeff * old_yl[0] + (1.f-attack_coeff)*xlink;
+			} else {
+				level = xlink;
+			}
+			level = sanitize_denormal(level);
+			gain = from_dB(-level);
+
+			for (c = 0; c < nch; c++) {
+				out = inputs[c][i] * gain * makeupgain;
+				outputs[c][i] = out;
+				max = fmaxf(max, fabsf(out));
+			}
+
+			old_yl[0] = level;
+			for (c = 0; c < ncurve; c++)
+				old_yg[c] = yg[c];
+			continue;
+		}
+
+		for (c = 0; c < nch; c++) {
+			old_yl[c] = sanitize_denormal(old_yl[c]);
+			if (xl[c] < old_yl[c]) {
+				yl[c] = release_coeff * old_yl[c] + (1.f-release_coeff)*xl[c];
+			} else if (xl[c] > old_yl[c]) {
+				yl[c] = attack_coeff * old_yl[c] + (1.f-attack_coeff)*xl[c];
+			} else {
+				yl[c] = xl[c];
+			}
+			yl[c] = sanitize_denormal(yl[c]);
+		}
+
+		for (c = 0; c < nch; c++) {
+			out = inputs[c][i] * from_dB(-yl[c]) * makeupgain;
+			outputs[c][i] = out;
+			max = fmaxf(max, fabsf(out));
+		}
+
+		for (c = 0; c < nch; c++) {
+			old_yl[c] = yl[c];
+			old_yg[c] = yg[c];
+		}
+        }
+
+	// Hand the shared envelope to every channel in case they uncouple
+	if (shared) {
+		for (c = 1; c < nch; c++) {
+			old_yl[c] = old_yl[0];
+			if (usesidechain)
+				old_yg[c] = old_yg[0];
+		}
+	}
+
+	gainred = 0.f;
+	for (c = 0; c < nch; c++)
+		gainred = fmaxf(gainred, old_yl[c]);
+	outlevel = (max == 0.f) ? -45.f : to_dB(max); // relative to - thresdb;
+    }
+
+// -----------------------------------------------------------------------
+
+Plugin* createPlugin()
+{
+    return new ZamCompX8Plugin();
+}
+
+// -----------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
@@ -0,0 +1,147 @@
+/*
+ * ZamCompX8 multichannel compressor
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef ZAMCOMPX8PLUGIN_HPP_INCLUDED
+#define ZAMCOMPX8PLUGIN_HPP_INCLUDED
+
+#define LINK_AVERAGE 0
+#define LINK_MAX 1
+#define LINK_UNCOUPLED 2
+
+#define MAX_CHANNELS DISTRHO_PLUGIN_NUM_OUTPUTS
+
+#include "DistrhoPlugin.hpp"
+#include "../../dsp/ZamDetector.hpp"
+
+START_NAMESPACE_DISTRHO
+
+// -----------------------------------------------------------------------
+
+class ZamCompX8Plugin : public Plugin
+{
+public:
+    enum Parameters
+    {
+        paramAttack = 0,
+        paramRelease,
+        paramKnee,
+        paramRatio,
+        paramThresh,
+        paramMakeup,
+        paramSlew,
+	paramLink,
+	paramChannels,
+	paramSidechain,
+	paramDetect,
+        paramGainRed,
+        paramOutputLevel,
+        paramCount
+    };
+
+    ZamCompX8Plugin();
+
+protected:
+    // -------------------------------------------------------------------
+    // Information
+
+    const char* getLabel() const noexcept override
+    {
+        return "ZamCompX8";
+    }
+
+    const char* getDescription() const noexcept override
+    {
+        return "Linked compressor for up to eight channels, ZamCompX2 with selectable channel linking.";
+    }
+
+    const char* getMaker() const noexcept override
+    {
+        return "Damien Zammit";
+    }
+
+    const char* getHomePage() const noexcept override
+    {
+        return "http://www.zamaudio.com";
+    }
+
+    const char* getLicense() const noexcept override
+    {
+        return "GPL v2+";
+    }
+
+    uint32_t getVersion() const noexcept override
+    {
+        return d_version(3, 12, 0);
+    }
+
+    int64_t getUniqueId() const noexcept override
+    {
+        return d_cconst('Z', 'C', 'P', '8');
+    }
+
+    // -------------------------------------------------------------------
+    // Init
+
+    void initParameter(uint32_t index, Parameter& parameter) override;
+    void initProgramName(uint32_t index, String& programName) override;
+    void initAudioPort(bool input, uint32_t index, AudioPort& port) override;
+
+    // -------------------------------------------------------------------
+    // Internal data
+
+    float getParameterValue(uint32_t index) const override;
+    void  setParameterValue(uint32_t index, float value) override;
+    void  loadProgram(uint32_t index);
+
+    // -------------------------------------------------------------------
+    // Process
+
+	static inline float
+	sanitize_denormal(float v) {
+	        if(!std::isnormal(v))
+	                return 0.f;
+	        return v;
+	}
+
+	static inline float
+	from_dB(float gdb) {
+	        return (exp(gdb/20.f*log(10.f)));
+	}
+
+	static inline float
+	to_dB(float g) {
+	        return (20.f*log10(g));
+	}
+
+    void activate() override;
+    void run(const float** inputs, float** outputs, uint32_t frames) override;
+
+    // -------------------------------------------------------------------
+
+private:
+    float attack,release,knee,ratio,thresdb,makeup,gainred,outlevel,sidechain,link,channels,slewfactor,detect; //parameters
+
+    /* Per channel state, one array per quantity so each step of the
+     * detector and gain computer is a flat loop across the channels */
+    float xg[MAX_CHANNELS], yg[MAX_CHANNELS], xl[MAX_CHANNELS], yl[MAX_CHANNELS];
+    float old_yl[MAX_CHANNELS], old_yg[MAX_CHANNELS];
+    ZamDetector detector[MAX_CHANNELS];
+};
+
+// -----------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif  // ZAMCOMPX8_HPP_INCLUDED
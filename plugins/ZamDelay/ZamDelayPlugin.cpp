@@ -24,10 +24,18 @@ START_NAMESPACE_DISTRHO
 ZamDelayPlugin::ZamDelayPlugin()
     : Plugin(paramCount, 1, 0)
 {
+    z = NULL;
+    bufsize = 0;
+
     // set default values
     loadProgram(0);
 }
 
+ZamDelayPlugin::~ZamDelayPlugin()
+{
+    free(z);
+}
+
 // -----------------------------------------------------------------------
 // Init
 
@@ -226,17 +234,32 @@ void ZamDelayPlugin::setParameterValue(uint32_t index, float value)
 
 void ZamDelayPlugin::activate()
 {
-	int i;
-	for (i = 0; i < MAX_DELAY; i++) {
-		z[i] = 0.f;
+	uint32_t maxn = (uint32_t)(MAX_DELAY_MS * getSampleRate() / 1000.f);
+	uint32_t size = 1;
+
+	while (size < maxn + 1)
+		size <<= 1;
+
+	if (size != bufsize) {
+		free(z);
+		z = (float *)malloc(size * sizeof(float));
+		if (z == NULL) {
+			/* run() passes audio through until a later activate() */
+			bufsize = 0;
+			mask = 0;
+			return;
+		}
+		bufsize = size;
+		mask = size - 1;
 	}
+	memset(z, 0, bufsize * sizeof(float));
 	posz = 0;
 	tap[0] = 0;
 	tap[1] = 0;
 	active = 0;
 	next = 1;
 	age = 0;
-	clearfilter();
+	lpfilter.reset();
 	fbstate = 0.f;
 
 	lpfold = 0.f;
@@ -252,50 +275,6 @@ void ZamDelayPlugin::activate()
 
 
 
-void ZamDelayPlugin::lpfRbj(float fc, float srate)
-{
-	float w0, alpha, cw, sw, q;
-	q = 0.707;
-	w0 = (2. * M_PI * fc / srate);
-	sw = sin(w0);
-	cw = cos(w0);
-	alpha = sw / (2. * q);
-
-	A0 = 1. + alpha;
-	A1 = -2. * cw;
-	A2 = 1. - alpha;
-	B0 = (1. - cw) / 2.;
-	B1 = (1. - cw);
-	B2 = B0;
-
-	A3 = 1. + alpha;
-	A4 = -2. * cw;
-	A5 = 1. - alpha;
-	B3 = (1. - cw) / 2.;
-	B4 = (1. - cw);
-	B5 = B3;
-}
-
-void ZamDelayPlugin::clearfilter(void)
-{
-	state[0] = state[1] = state[2] = state[3] = 0.f;
-}
-
-float ZamDelayPlugin::runfilter(float in)
-{
-	float out;
-	in = sanitize_denormal(in);
-
-	out = B0/A0*in + B1/A0*state[0] + B2/A0*state[1]
-			-A1/A0*state[2] - A2/A0*state[3] + 1e-12;
-
-	state[1] = state[0];
-	state[0] = in;
-	state[3] = state[2];
-	state[2] = out;
-	return out;
-}
-
 void ZamDelayPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
 	uint32_t i;
@@ -304,10 +283,18 @@ void ZamDelayPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 	TimePosition t = getTimePosition();
 	float bpm = 120.f;
 	int delaysamples;
+	float dsamp;
 	unsigned int tmp;
 	float inv;
 	float xfade;
 	int recalc;
+
+	if (bufsize == 0) {
+		for (i = 0; i < frames; i++)
+			outputs[0][i] = inputs[0][i];
+		return;
+	}
+
 	if (invert < 0.5) {
 		inv = -1.f;
 	} else {
@@ -322,10 +309,13 @@ void ZamDelayPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 			delaytimeout = (float)t.bbt.beatType * 1000.f * 60.f / (bpm * powf(2., divisor - 1.));
 		}
 	}
-	delaysamples = (int)(delaytimeout * srate) / 1000;
+	/* Slow tempos can ask for more than the line holds, clamp before
+	 * converting so the sample count cannot overflow an int */
+	dsamp = MIN(delaytimeout * srate, 1000.f * mask);
+	delaysamples = MIN((int)((int64_t)dsamp / 1000), (int)mask);
 	
 	if (lpf != lpfold) {
-		lpfRbj(lpf, srate);
+		lpfilter.setLowpass(0, lpf, srate, 0.707);
 	}
 	if (divisor != divisorold) {
 		recalc = 1;
@@ -355,21 +345,15 @@ void ZamDelayPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 		in = inputs[0][i];
 		z[posz] = in + feedb * fbstate;
 		fbstate = 0.f;
-		int p = posz - tap[active]; // active line
-		if (p<0) p += MAX_DELAY;
-		fbstate += z[p];
+		fbstate += z[(posz - tap[active]) & mask]; // active line
 		
 		if (recalc) {
 			xfade += 1.0f / (float)frames;
 			fbstate *= (1.-xfade);
-			int p = posz - tap[next]; // next line
-			if (p<0) p += MAX_DELAY;
-			fbstate += z[p] * xfade;
-		}
-		outputs[0][i] = from_dB(gain) * ((1.-drywet)*in + drywet * -inv * runfilter(fbstate));
-		if (++posz >= MAX_DELAY) {
-			posz = 0;
+			fbstate += z[(posz - tap[next]) & mask] * xfade; // next line
 		}
+		outputs[0][i] = from_dB(gain) * ((1.-drywet)*in + drywet * -inv * lpfilter.tick(fbstate));
+		posz = (posz + 1) & mask;
 	}
 	lpfold = lpf;
 	divisorold = divisor;
@@ -17,9 +17,11 @@
 #define ZAMCOMPPLUGIN_HPP_INCLUDED
 
 #include "DistrhoPlugin.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include "../../dsp/ZamBiquad.hpp"
 
-// 8 seconds of delay at 96kHz
-#define MAX_DELAY 768000
+#define MAX_DELAY_MS 8000	/* longest delay, the line is sized from it */
 #define MAX(a,b) ((a) < (b) ? (b) : (a))
 #define MIN(a,b) ((a) > (b) ? (b) : (a))
 #define LIN_INTERP(f,a,b) ((a) + (f) * ((b) - (a)))
@@ -46,6 +48,7 @@ public:
     };
 
     ZamDelayPlugin();
+    ~ZamDelayPlugin() override;
 
 protected:
     // -------------------------------------------------------------------
@@ -121,23 +124,20 @@ protected:
 
     void activate() override;
     void run(const float** inputs, float** outputs, uint32_t frames) override;
-    void clearfilter(void);
-    void lpfRbj(float fc, float srate);
-    float runfilter(float in);
 
     // -------------------------------------------------------------------
 
 private:
     float invert, feedb, delaytime, sync, lpf, divisor, gain, drywet, delaytimeout;
     float invertold, feedbold, delaytimeold, syncold, lpfold, divisorold, gainold, drywetold, delaytimeoutold, delaysamplesold;
-    float z[MAX_DELAY];
+    float *z;
+    uint32_t bufsize, mask;	// power of two delay line, allocated in activate()
     unsigned int posz;
     unsigned int tap[2];
     int active;
     int next;
     int age;
-    float A0, A1, A2, A3, A4, A5, B0, B1, B2, B3, B4, B5;
-    float state[4];
+    ZamBiquadCascade<float, 1, 1> lpfilter;
     float fbstate;
 };
 
@@ -17,6 +17,9 @@
 
 START_NAMESPACE_DISTRHO
 
+/* Nodes 2 and up start out off, spread over the bass, mids and sibilance */
+static const float nodefreqdef[DEQ_EXTRANODES] = { 100.f, 1000.f, 7000.f };
+
 // -----------------------------------------------------------------------
 
 ZamDynamicEQPlugin::ZamDynamicEQPlugin()
@@ -44,31 +47,40 @@ void ZamDynamicEQPlugin::initProgramName(uint32_t index, String& programName)
 // -----------------------------------------------------------------------
 // Process
 
-void ZamDynamicEQPlugin::reset_low()
+void ZamDynamicEQPlugin::reset_target(int n)
 {
-    zln1=zln2=zld1=zld2=0.f;
-}
-
-void ZamDynamicEQPlugin::reset_high()
-{
-    zhn1=zhn2=zhd1=zhd2=0.f;
-}
-
-void ZamDynamicEQPlugin::reset_peak()
-{
-    x1a=x2a=y1a=y2a=0.f;
+    int c;
+    for (c = 0; c < DEQ_CHANNELS; c++)
+        target[c].reset(n);
 }
 
 void ZamDynamicEQPlugin::activate()
 {
-    oldL_yl = oldL_y1 = oldL_yg = 0.f;
+    int k, n, c, l;
 
-    gainy = 0.f;
-
-    reset_low();
-    reset_high();
-    reset_peak();
     linear_svf_reset(&bandpass);
+
+    /* Every node starts at 0 dB with its table rebuilt on the next run */
+    for (n = 0; n < DEQ_NODES; n++) {
+        tabtype[n] = -1;
+        tabgen[n] = 0;
+        for (k = 0; k < DEQ_TABSIZE; k++)
+            tabstamp[n][k] = 0;
+    }
+    for (l = 0; l < DEQ_LANES; l++) {
+        oldL_yl[l] = oldL_y1[l] = oldL_yg[l] = 0.f;
+        for (k = 0; k < 5; k++) {
+            cur[l][k] = next[l][k] = (k == 0) ? 1. : 0.;
+            step[l][k] = 0.;
+        }
+        curgain[l] = nextgain[l] = 0.f;
+    }
+    for (c = 0; c < DEQ_CHANNELS; c++) {
+        target[c].reset();
+        for (n = 0; n < DEQ_NODES; n++)
+            target[c].setActive(n, false);
+    }
+    ctl = DEQ_CONTROL;
 }
 
 void ZamDynamicEQPlugin::initParameter(uint32_t index, Parameter& parameter)
@@ -219,6 +231,173 @@ void ZamDynamicEQPlugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.min = -10.0f;
         parameter.ranges.max = 0.0f;
         break;
+#if DEQ_CHANNELS > 1
+    case paramLink:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "Link";
+        parameter.symbol     = "link";
+        parameter.unit       = " ";
+        parameter.ranges.def = 1.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    case paramMidSide:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "Mid/Side";
+        parameter.symbol     = "midside";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+#endif
+    default:
+        initNodeParameter(index, parameter);
+        break;
+    }
+}
+
+/* Nodes 2 and up are laid out as blocks of nodeParamCount parameters */
+void ZamDynamicEQPlugin::initNodeParameter(uint32_t index, Parameter& parameter)
+{
+    char name[32], symbol[16];
+
+    if (index < paramNodeStart || index >= paramCount)
+        return;
+
+    int k = (index - paramNodeStart) / nodeParamCount;
+
+    switch ((index - paramNodeStart) % nodeParamCount)
+    {
+    case nodeType:
+        /* Off, Low shelf, Peak, High shelf */
+        snprintf(name, sizeof(name), "Type %d", k + 2);
+        snprintf(symbol, sizeof(symbol), "type%d", k + 2);
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.unit       = " ";
+        parameter.ranges.def = TARGET_OFF;
+        parameter.ranges.min = TARGET_OFF;
+        parameter.ranges.max = TARGET_HIGH;
+        break;
+    case nodeDetectFreq:
+        snprintf(name, sizeof(name), "Detect Frequency %d", k + 2);
+        snprintf(symbol, sizeof(symbol), "detectfreq%d", k + 2);
+        parameter.hints      = kParameterIsAutomable | kParameterIsLogarithmic;
+        parameter.unit       = "Hz";
+        parameter.ranges.def = nodefreqdef[k];
+        parameter.ranges.min = 20.0f;
+        parameter.ranges.max = 16000.0f;
+        break;
+    case nodeTargetFreq:
+        snprintf(name, sizeof(name), "Target Frequency %d", k + 2);
+        snprintf(symbol, sizeof(symbol), "targetfreq%d", k + 2);
+        parameter.hints      = kParameterIsAutomable | kParameterIsLogarithmic;
+        parameter.unit       = "Hz";
+        parameter.ranges.def = nodefreqdef[k];
+        parameter.ranges.min = 20.0f;
+        parameter.ranges.max = 16000.0f;
+        break;
+    case nodeTargetWidth:
+        snprintf(name, sizeof(name), "Target width %d", k + 2);
+        snprintf(symbol, sizeof(symbol), "targetwidth%d", k + 2);
+        parameter.hints      = kParameterIsAutomable;
+        parameter.unit       = "oct";
+        parameter.ranges.def = 1.0f;
+        parameter.ranges.min = 1.0f;
+        parameter.ranges.max = 5.0f;
+        break;
+    case nodeThresh:
+        snprintf(name, sizeof(name), "Threshold %d", k + 2);
+        snprintf(symbol, sizeof(symbol), "thr%d", k + 2);
+        parameter.hints      = kParameterIsAutomable;
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = -80.0f;
+        parameter.ranges.max = 0.0f;
+        break;
+    case nodeBoostCut:
+        snprintf(name, sizeof(name), "Boost / Cut %d", k + 2);
+        snprintf(symbol, sizeof(symbol), "boostcut%d", k + 2);
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    case nodeControlGain:
+        snprintf(name, sizeof(name), "Control Gain %d", k + 2);
+        snprintf(symbol, sizeof(symbol), "controlgain%d", k + 2);
+        parameter.hints      = kParameterIsOutput;
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = -10.0f;
+        parameter.ranges.max = 10.0f;
+        break;
+    }
+    parameter.name   = name;
+    parameter.symbol = symbol;
+}
+
+float ZamDynamicEQPlugin::getNodeParameter(uint32_t index) const
+{
+    if (index < paramNodeStart || index >= paramCount)
+        return 0.0f;
+
+    int k = (index - paramNodeStart) / nodeParamCount + 1;
+
+    switch ((index - paramNodeStart) % nodeParamCount)
+    {
+    case nodeType:
+        return nodetype[k];
+    case nodeDetectFreq:
+        return nodedetect[k];
+    case nodeTargetFreq:
+        return nodetarget[k];
+    case nodeTargetWidth:
+        return nodewidth[k];
+    case nodeThresh:
+        return nodethresh[k];
+    case nodeBoostCut:
+        return nodeboostcut[k];
+    case nodeControlGain:
+        return nodegain[k];
+    default:
+        return 0.0f;
+    }
+}
+
+void ZamDynamicEQPlugin::setNodeParameter(uint32_t index, float value)
+{
+    if (index < paramNodeStart || index >= paramCount)
+        return;
+
+    int k = (index - paramNodeStart) / nodeParamCount + 1;
+
+    switch ((index - paramNodeStart) % nodeParamCount)
+    {
+    case nodeType:
+        nodetype[k] = std::min(std::max((int)(value + 0.5f), TARGET_OFF), TARGET_HIGH);
+        reset_target(k);
+        break;
+    case nodeDetectFreq:
+        nodedetect[k] = value;
+        break;
+    case nodeTargetFreq:
+        nodetarget[k] = value;
+        break;
+    case nodeTargetWidth:
+        nodewidth[k] = value;
+        break;
+    case nodeThresh:
+        nodethresh[k] = value;
+        break;
+    case nodeBoostCut:
+        nodeboostcut[k] = value;
+        reset_target(k);
+        break;
+    case nodeControlGain:
+        nodegain[k] = value;
+        break;
     }
 }
 
@@ -226,7 +405,7 @@ void ZamDynamicEQPlugin::initAudioPort(bool input, uint32_t index, AudioPort& po
 {
 	Plugin::initAudioPort(input, index, port);
 
-	if ((index == 1) && input) {
+	if ((index == DEQ_CHANNELS) && input) {
 		port.hints |= kAudioPortIsSidechain;
 		port.name = "Sidechain Input";
 		port.symbol = "sidechain_in";
@@ -235,6 +414,22 @@ void ZamDynamicEQPlugin::initAudioPort(bool input, uint32_t index, AudioPort& po
 
 void ZamDynamicEQPlugin::loadProgram(uint32_t index)
 {
+	int k;
+
+	link = 1.0;
+	midside = 0.0;
+
+	/* The programs only use the first node */
+	for (k = 1; k < DEQ_NODES; k++) {
+		nodetype[k] = TARGET_OFF;
+		nodedetect[k] = nodefreqdef[k - 1];
+		nodetarget[k] = nodefreqdef[k - 1];
+		nodewidth[k] = 1.0;
+		nodethresh[k] = 0.0;
+		nodeboostcut[k] = 0.0;
+		nodegain[k] = 0.0;
+	}
+
 	switch(index) {
 	case 0:
 		attack = 10.0;
@@ -349,8 +544,16 @@ float ZamDynamicEQPlugin::getParameterValue(uint32_t index) const
     case paramControlGain:
         return controlgain;
         break;
+#if DEQ_CHANNELS > 1
+    case paramLink:
+        return link;
+        break;
+    case paramMidSide:
+        return midside;
+        break;
+#endif
     default:
-        return 0.0f;
+        return getNodeParameter(index);
     }
 }
 
@@ -384,21 +587,15 @@ void ZamDynamicEQPlugin::setParameterValue(uint32_t index, float value)
         break;
     case paramToggleLow:
         toglow = value;
-        reset_low();
-        reset_high();
-        reset_peak();
+        reset_target(0);
         break;
     case paramTogglePeak:
         togpeak = value;
-        reset_low();
-        reset_high();
-        reset_peak();
+        reset_target(0);
         break;
     case paramToggleHigh:
         toghigh = value;
-        reset_low();
-        reset_high();
-        reset_peak();
+        reset_target(0);
         break;
     case paramDetectFreq:
         detectfreq = value;
@@ -411,13 +608,24 @@ void ZamDynamicEQPlugin::setParameterValue(uint32_t index, float value)
         break;
     case paramBoostCut:
         boostcut = value;
-        reset_low();
-        reset_high();
-        reset_peak();
+        reset_target(0);
         break;
     case paramControlGain:
         controlgain = value;
         break;
+#if DEQ_CHANNELS > 1
+    case paramLink:
+        link = value;
+        break;
+    case paramMidSide:
+        midside = value;
+        for (int n = 0; n < DEQ_NODES; n++)
+            reset_target(n);
+        break;
+#endif
+    default:
+        setNodeParameter(index, value);
+        break;
     }
 }
 
@@ -426,14 +634,14 @@ void ZamDynamicEQPlugin::setParameterValue(uint32_t index, float value)
  * http://www.cytomic.com/files/dsp/SvfLinearTrapOptimised2.pdf
  */
 
-void ZamDynamicEQPlugin::linear_svf_set_params(struct linear_svf *self, float sample_rate, float cutoff, float resonance)
+void ZamDynamicEQPlugin::linear_svf_set_params(struct linear_svf *self, int n, float sample_rate, float cutoff, float resonance)
 {
-	self->g = tanf(M_PI * (cutoff / sample_rate));
-	self->k = 1.f / resonance;
+	self->g[n] = tanf(M_PI * (cutoff / sample_rate));
+	self->k[n] = 1.f / resonance;
 
-	self->a[0] = 1.f / (1.f + self->g * (self->g + self->k));
-	self->a[1] = self->g * self->a[0];
-	self->a[2] = self->g * self->a[1];
+	self->a[0][n] = 1.f / (1.f + self->g[n] * (self->g[n] + self->k[n]));
+	self->a[1][n] = self->g[n] * self->a[0][n];
+	self->a[2][n] = self->g[n] * self->a[1][n];
 
 	self->m[0] = 0.f;
 	self->m[1] = 1.f;
@@ -442,27 +650,36 @@ void ZamDynamicEQPlugin::linear_svf_set_params(struct linear_svf *self, float sa
 
 void ZamDynamicEQPlugin::linear_svf_reset(struct linear_svf *self)
 {
-	self->s[0][0]     = 
-		self->s[0][1] = 
-		self->s[1][0] = 
-		self->s[1][1] = 0.f;
+	int n;
+	for (n = 0; n < DEQ_LANES; n++) {
+		self->s[0][0][n]     = 
+			self->s[0][1][n] = 
+			self->s[1][0][n] = 
+			self->s[1][1][n] = 0.f;
+	}
 }
 
-float ZamDynamicEQPlugin::run_linear_svf(struct linear_svf *self, int c, float in)
+/* Stage c of every detector, a lane each */
+void ZamDynamicEQPlugin::run_linear_svf(struct linear_svf *self, int c,
+		const float in[DEQ_LANES], float out[DEQ_LANES])
 {
-	float v[3];
+	int n;
+
+	for (n = 0; n < DEQ_LANES; n++) {
+		float v[3];
 
-	v[2] = in - self->s[c][1];
-	v[0] = (self->a[0] * self->s[c][0]) + (self->a[1] * v[2]);
-	v[1] = self->s[c][1] + (self->a[1] * self->s[c][0]) + (self->a[2] * v[2]);
+		v[2] = in[n] - self->s[c][1][n];
+		v[0] = (self->a[0][n] * self->s[c][0][n]) + (self->a[1][n] * v[2]);
+		v[1] = self->s[c][1][n] + (self->a[1][n] * self->s[c][0][n]) + (self->a[2][n] * v[2]);
 
-	self->s[c][0] = (2.f * v[0]) - self->s[c][0];
-	self->s[c][1] = (2.f * v[1]) - self->s[c][1];
+		self->s[c][0][n] = (2.f * v[0]) - self->s[c][0][n];
+		self->s[c][1][n] = (2.f * v[1]) - self->s[c][1][n];
 
-	return
-		(self->m[0] * in)
-		+ (self->m[1] * v[0])
-		+ (self->m[2] * v[1]);
+		out[n] =
+			(self->m[0] * in[n])
+			+ (self->m[1] * v[0])
+			+ (self->m[2] * v[1]);
+	}
 }
 
 void ZamDynamicEQPlugin::peq(double G0, double G, double GB, double w0, double Dw,
@@ -547,201 +764,274 @@ void ZamDynamicEQPlugin::highshelfeq(double, double G, double, double w0, double
         A[2] = a2/a0;
 }
 
-void ZamDynamicEQPlugin::run_lowshelf(double input, double* output)
+/* Takes node n's current target settings, its entries are designed on use */
+void ZamDynamicEQPlugin::set_table(int n, float srate)
 {
-        double in = input;
-        zln1 = sanitize_denormal(zln1);
-        zln2 = sanitize_denormal(zln2);
-        zld1 = sanitize_denormal(zld1);
-        zld2 = sanitize_denormal(zld2);
-        in = sanitize_denormal(in);
-
-        *output = in * Bl[0] +
-                zln1 * Bl[1] +
-                zln2 * Bl[2] -
-                zld1 * Al[1] -
-                zld2 * Al[2] + 1e-20;
-
-        *output = sanitize_denormal(*output);
-        zln2 = zln1;
-        zld2 = zld1;
-        zln1 = in;
-        zld1 = *output;
+        tabtype[n] = nodetype[n];
+        tabfreq[n] = nodetarget[n];
+        tabwidth[n] = nodewidth[n];
+        tabsrate[n] = srate;
+        tabgen[n]++;
 }
 
-void ZamDynamicEQPlugin::run_highshelf(double input, double* output)
+/*
+ * Designs node n's target filter at gain step k of the table, at 0 dB
+ * or with the node off it is left as an exact passthrough.
+ */
+void ZamDynamicEQPlugin::set_entry(int n, int k)
 {
-        double in = input;
-        zhn1 = sanitize_denormal(zhn1);
-        zhn2 = sanitize_denormal(zhn2);
-        zhd1 = sanitize_denormal(zhd1);
-        zhd2 = sanitize_denormal(zhd2);
-        in = sanitize_denormal(in);
-
-        *output = in   * Bh[0] +
-                  zhn1 * Bh[1] +
-                  zhn2 * Bh[2] -
-                  zhd1 * Ah[1] -
-                  zhd2 * Ah[2] + 1e-20;
-
-        *output = sanitize_denormal(*output);
-        zhn2 = zhn1;
-        zhd2 = zhd1;
-        zhn1 = in;
-        zhd1 = *output;
+        const int type = tabtype[n];
+        const float targetfreq = tabfreq[n];
+        const float targetwidth = tabwidth[n];
+        const float srate = tabsrate[n];
+        double dcgain = 1.f;
+        double qq2, boost2, fc2, w02, bwgain2, bw2;
+        double boostl, All, bwl, bwgaindbl;
+        double boosth, Ahh, bwh, bwgaindbh;
+        double a0, a1, a2, b0, b1, b2, gn;
+        double B[3], A[3];
+        double gdb = (double)(k - DEQ_TABDB * DEQ_TABSTEP) / DEQ_TABSTEP;
+        double *c = tab[n][k];
+
+        tabstamp[n][k] = tabgen[n];
+
+        if (k == DEQ_TABDB * DEQ_TABSTEP || type == TARGET_OFF) {
+                c[0] = 1.;
+                c[1] = c[2] = c[3] = c[4] = 0.;
+                return;
+        }
+        if (type == TARGET_LOW) {
+                bwl = 2.f*M_PI*targetfreq / srate;
+                boostl = from_dB(gdb);
+                All = sqrt(boostl);
+                bwgaindbl = to_dB(All);
+                lowshelfeq(0.f,gdb,bwgaindbl,bwl,bwl,0.707f,B,A);
+        } else if (type == TARGET_PEAK) {
+                qq2 = pow(2.0, 1.0/targetwidth)/(pow(2.0, targetwidth) - 1.0); //q from octave bw
+                boost2 = from_dB(gdb);
+                fc2 = targetfreq / srate;
+                w02 = fc2*2.f*M_PI;
+                bwgain2 = sqrt(boost2);
+                bw2 = fc2 / qq2;
+                peq(dcgain,boost2,bwgain2,w02,bw2,&a0,&a1,&a2,&b0,&b1,&b2,&gn);
+                B[0] = b0 / a0;
+                B[1] = b1 / a0;
+                B[2] = b2 / a0;
+                A[1] = a1 / a0;
+                A[2] = a2 / a0;
+        } else {
+                bwh = 2.f*M_PI*targetfreq / srate;
+                boosth = from_dB(gdb);
+                Ahh = sqrt(boosth);
+                bwgaindbh = to_dB(Ahh);
+                highshelfeq(0.f,gdb,bwgaindbh,bwh,bwh,0.707f,B,A);
+        }
+        c[0] = B[0];
+        c[1] = B[1];
+        c[2] = B[2];
+        c[3] = A[1];
+        c[4] = A[2];
 }
 
-void ZamDynamicEQPlugin::run_peq2(double input, double* output)
+/* Coefficients at gdb dB, linear between the two nearest table entries */
+void ZamDynamicEQPlugin::lookup_table(int n, float gdb, double c[5])
 {
-        double in = input;
-        x1a = sanitize_denormal(x1a);
-        x2a = sanitize_denormal(x2a);
-        y1a = sanitize_denormal(y1a);
-        y2a = sanitize_denormal(y2a);
-        in = sanitize_denormal(in);
-
-        *output = in * b0y + x1a * b1y + x2a * b2y - y1a * a1y - y2a * a2y
-                + 1e-20;
-
-        *output = sanitize_denormal(*output);
-        x2a = x1a;
-        y2a = y1a;
-        x1a = in;
-        y1a = *output;
+        float x = (std::min(std::max(gdb, (float)-DEQ_TABDB), (float)DEQ_TABDB)
+                        + DEQ_TABDB) * DEQ_TABSTEP;
+        int i = std::min((int)x, DEQ_TABSIZE - 2);
+        double f = x - i;
+        int k;
+
+        if (tabstamp[n][i] != tabgen[n])
+                set_entry(n, i);
+        if (tabstamp[n][i+1] != tabgen[n])
+                set_entry(n, i + 1);
+
+        for (k = 0; k < 5; k++)
+                c[k] = tab[n][i][k] + f * (tab[n][i+1][k] - tab[n][i][k]);
 }
 
-void ZamDynamicEQPlugin::run_comp(double input, double* output)
+/*
+ * The gain change in dB of every lane for one sample of its detector.
+ * Linked channels all take the largest reduction of each node before
+ * smoothing, so their envelopes and target filters move together.
+ */
+void ZamDynamicEQPlugin::run_comp(const float in[DEQ_LANES], float cdb[DEQ_LANES])
 {
-	float srate = getSampleRate();
 	float width = (6.f * knee) + 0.01;
 	float slewwidth = 1.8f;
-        float cdb=0.f;
-        float attack_coeff = exp(-1000.f/(attack * srate));
-        float release_coeff = exp(-1000.f/(release * srate));
-
-        int attslew = 0;
-	float lgaininp = 0.f;
-	float Lgain = 1.f;
-        float Lxg, Lxl, Lyg, Lyl, Ly1;
-        float checkwidth = 0.f;
-	float in;
-
-        in = input;
-        attslew = 0;
-	Lyg = 0.f;
-	Lxg = (in==0.f) ? -160.f : to_dB(fabs(in));
-        Lxg = sanitize_denormal(Lxg);
-
-        Lyg = Lxg + (1.f/ratio-1.f)*(Lxg-thresdb+width/2.f)*(Lxg-thresdb+width/2.f)/(2.f*width);
-
-	checkwidth = 2.f*fabs(Lxg-thresdb);
-        if (2.f*(Lxg-thresdb) < -width) {
-                Lyg = Lxg;
-        } else if (checkwidth <= width) {
-		Lyg = thresdb + (Lxg-thresdb)/ratio;
-		Lyg = sanitize_denormal(Lyg);
-		if (checkwidth <= slewwidth) {
-			if (Lyg >= oldL_yg) {
-				attslew = 1;
+	float xg[DEQ_LANES], xl[DEQ_LANES];
+	int attslew[DEQ_LANES];
+	int n, c, l;
+
+	/*
+	 * Levels and static curve of all lanes in one go, written as selects
+	 * rather than branches so the log and the rest run across the lanes
+	 * together. Silence reads -160 dB as it always has, anything above it
+	 * keeps its exact level. Above and inside the knee the curve is the
+	 * same straight line.
+	 */
+	for (l = 0; l < DEQ_LANES; l++)
+		xg[l] = (in[l] == 0.f) ? -160.f : to_dB(fabsf(in[l]));
+
+	for (l = 0; l < DEQ_LANES; l++) {
+        const float thresdb = nodethresh[l / DEQ_CHANNELS];
+        const float d = xg[l] - thresdb;
+        const float checkwidth = 2.f*fabsf(d);
+        float Lyg = (2.f*d < -width) ? xg[l] : thresdb + d/ratio;
+
+        attslew[l] = (checkwidth <= width && checkwidth <= slewwidth && Lyg >= oldL_yg[l]);
+        xl[l] = (nodetype[l / DEQ_CHANNELS] == TARGET_OFF) ? 0.f : xg[l] - Lyg;
+        oldL_yg[l] = Lyg;
+	}
+
+	if (DEQ_CHANNELS > 1 && link > 0.5) {
+		for (n = 0; n < DEQ_NODES; n++) {
+			l = n * DEQ_CHANNELS;
+			float xlink = xl[l];
+			int slew = attslew[l];
+			for (c = 1; c < DEQ_CHANNELS; c++) {
+				xlink = fmaxf(xlink, xl[l + c]);
+				slew |= attslew[l + c];
+			}
+			for (c = 0; c < DEQ_CHANNELS; c++) {
+				xl[l + c] = xlink;
+				attslew[l + c] = slew;
 			}
 		}
-        } else if (2.f*(Lxg-thresdb) > width) {
-                Lyg = thresdb + (Lxg-thresdb)/ratio;
-                Lyg = sanitize_denormal(Lyg);
-        }
-
-        attack_coeff = attslew ? exp(-1000.f/((attack + 2.0*(slewfactor - 1)) * srate)) : attack_coeff;
-
-        Lxl = Lxg - Lyg;
-
-        oldL_y1 = sanitize_denormal(oldL_y1);
-        oldL_yl = sanitize_denormal(oldL_yl);
-        Ly1 = fmaxf(Lxl, release_coeff * oldL_y1+(1.f-release_coeff)*Lxl);
-        Lyl = attack_coeff * oldL_yl+(1.f-attack_coeff)*Ly1;
-        Ly1 = sanitize_denormal(Ly1);
-        Lyl = sanitize_denormal(Lyl);
+	}
 
-        cdb = -Lyl;
-        Lgain = from_dB(cdb);
+	for (l = 0; l < DEQ_LANES; l++) {
+        float coeff = attslew[l] ? slew_coeff : attack_coeff;
+        float Lxl = xl[l], Lyl, Ly1;
 
-        //gainred = Lyl;
+        /* Stored values are already flushed, and nodes that are off just decay */
+        Ly1 = fmaxf(Lxl, release_coeff * oldL_y1[l]+(1.f-release_coeff)*Lxl);
+        Lyl = coeff * oldL_yl[l]+(1.f-coeff)*Ly1;
+        Ly1 = (fabsf(Ly1) < FLT_MIN) ? 0.f : Ly1;
+        Lyl = (fabsf(Lyl) < FLT_MIN) ? 0.f : Lyl;
 
-        lgaininp = Lgain * in;
-        *output = lgaininp;
+        cdb[l] = -Lyl;
 
-        oldL_yl = Lyl;
-        oldL_y1 = Ly1;
-        oldL_yg = Lyg;
+        oldL_yl[l] = Lyl;
+        oldL_y1[l] = Ly1;
+	}
 }
 
 void ZamDynamicEQPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
         float srate = getSampleRate();
-        double dcgain = 1.f;
-        double qq2, boost2, fc2, w02, bwgain2, bw2;
-        double boostl, All, bwl, bwgaindbl;
-        double boosth, Ahh, bwh, bwgaindbh;
-
 	int choose = (sidechain < 0.5) ? 0 : 1;
-	float gaincontrol = 0.f;
+	int ms = (DEQ_CHANNELS == 2 && midside > 0.5) ? 1 : 0;
+	int k, n, c, l;
+
+	/* Node 1 always has a target, chosen by the toggles */
+	nodetype[0] = (toglow > 0.5) ? TARGET_LOW : (togpeak > 0.5) ? TARGET_PEAK : TARGET_HIGH;
+	nodedetect[0] = detectfreq;
+	nodetarget[0] = targetfreq;
+	nodewidth[0] = targetwidth;
+	nodethresh[0] = thresdb;
+	nodeboostcut[0] = boostcut;
+
+	/* The tables are per node, shared by its channels */
+	for (n = 0; n < DEQ_NODES; n++) {
+		if (nodetype[n] != tabtype[n] || nodetarget[n] != tabfreq[n]
+				|| nodewidth[n] != tabwidth[n] || srate != tabsrate[n])
+			set_table(n, srate);
+	}
+	for (l = 0; l < DEQ_LANES; l++)
+		linear_svf_set_params(&bandpass, l, srate, nodedetect[l / DEQ_CHANNELS], 4.);
 
-	linear_svf_set_params(&bandpass, srate, detectfreq, 4.);
+	attack_coeff = exp(-1000.f/(attack * srate));
+	release_coeff = exp(-1000.f/(release * srate));
+	slew_coeff = exp(-1000.f/((attack + 2.0*(slewfactor - 1)) * srate));
 
 	uint32_t i;
 	for (i = 0; i < frames; i++) {
-		double tmp, filtered, out;
-		double in = inputs[0][i];
-		in = sanitize_denormal(in);
-		tmp = sanitize_denormal(inputs[choose][i]);
-		filtered = tmp;
-		out = in;
-
-		filtered = run_linear_svf(&bandpass, 0,  tmp);
-		filtered = run_linear_svf(&bandpass, 1,  filtered);
-		run_comp(filtered, &tmp);
-
-		gaincontrol = tmp / filtered;
-		controlgain = sanitize_denormal(to_dB(gaincontrol));
-		if (boostcut > 0.5) {
-			controlgain = -controlgain;
-			if (controlgain < 0.f)
-				controlgain = 0.f;
-			else if (controlgain > max)
-				controlgain = max;
-		} else {
-			if (controlgain > 0.f)
-				controlgain = 0.f;
-			else if (controlgain < -max)
-				controlgain = -max;
+		float tmp[DEQ_LANES], filtered[DEQ_LANES], gdb[DEQ_LANES];
+		double in[DEQ_CHANNELS];
+		for (c = 0; c < DEQ_CHANNELS; c++)
+			in[c] = sanitize_denormal(inputs[c][i]);
+		if (ms) {
+			double mid = (in[0] + in[1]) * 0.5;
+			in[1] = (in[0] - in[1]) * 0.5;
+			in[0] = mid;
 		}
 
-		if (controlgain != 0.f) {
-			if (toglow) {
-				bwl = 2.f*M_PI*targetfreq / srate;
-				boostl = from_dB(controlgain);
-				All = sqrt(boostl);
-				bwgaindbl = to_dB(All);
-				lowshelfeq(0.f,controlgain,bwgaindbl,bwl,bwl,0.707f,Bl,Al);
-				run_lowshelf(in, &out);
-			} else if (togpeak) {
-				qq2 = pow(2.0, 1.0/targetwidth)/(pow(2.0, targetwidth) - 1.0); //q from octave bw
-				boost2 = from_dB(controlgain);
-				fc2 = targetfreq / srate;
-				w02 = fc2*2.f*M_PI;
-				bwgain2 = sqrt(boost2);
-				bw2 = fc2 / qq2;
-				peq(dcgain,boost2,bwgain2,w02,bw2,&a0y,&a1y,&a2y,&b0y,&b1y,&b2y,&gainy);
-				run_peq2(in, &out);
-			} else {
-				bwh = 2.f*M_PI*targetfreq / srate;
-				boosth = from_dB(controlgain);
-				Ahh = sqrt(boosth);
-				bwgaindbh = to_dB(Ahh);
-				highshelfeq(0.f,controlgain,bwgaindbh,bwh,bwh,0.707f,Bh,Ah);
-				run_highshelf(in, &out);
+		/* Each channel detects itself unless the sidechain is on */
+		if (choose) {
+			float side = sanitize_denormal(inputs[DEQ_CHANNELS][i]);
+			for (l = 0; l < DEQ_LANES; l++)
+				tmp[l] = side;
+		} else {
+			for (l = 0; l < DEQ_LANES; l++)
+				tmp[l] = in[l % DEQ_CHANNELS];
+		}
+		run_linear_svf(&bandpass, 0, tmp, filtered);
+		run_linear_svf(&bandpass, 1, filtered, filtered);
+		run_comp(filtered, gdb);
+
+		/*
+		 * At the control rate the gains are read and each filter heads
+		 * for its coefficients, arriving there DEQ_CONTROL samples later.
+		 */
+		if (--ctl == 0) {
+			for (n = 0; n < DEQ_NODES; n++)
+				nodegain[n] = 0.f;
+			for (l = 0; l < DEQ_LANES; l++) {
+				n = l / DEQ_CHANNELS;
+				float g = (filtered[l] == 0.f || nodetype[n] == TARGET_OFF) ?
+						0.f : sanitize_denormal(gdb[l]);
+				if (nodeboostcut[n] > 0.5) {
+					g = -g;
+					if (g < 0.f)
+						g = 0.f;
+					else if (g > max)
+						g = max;
+				} else {
+					if (g > 0.f)
+						g = 0.f;
+					else if (g < -max)
+						g = -max;
+				}
+				/* Each node shows its largest gain across the channels */
+				if (fabsf(g) > fabsf(nodegain[n]))
+					nodegain[n] = g;
+
+				curgain[l] = nextgain[l];
+				nextgain[l] = g;
+				for (k = 0; k < 5; k++)
+					cur[l][k] = next[l][k];
+				lookup_table(n, nextgain[l], next[l]);
+				for (k = 0; k < 5; k++)
+					step[l][k] = (next[l][k] - cur[l][k]) / DEQ_CONTROL;
+
+				/* Nodes resting at 0 dB are left out of the cascade once rung out */
+				target[l % DEQ_CHANNELS].setActive(n, curgain[l] != 0.f || nextgain[l] != 0.f
+						|| !target[l % DEQ_CHANNELS].settled(n));
 			}
+			controlgain = nodegain[0];
+			ctl = DEQ_CONTROL;
+		}
+
+		for (l = 0; l < DEQ_LANES; l++) {
+			if (curgain[l] == 0.f && nextgain[l] == 0.f)
+				continue;
+			for (k = 0; k < 5; k++)
+				cur[l][k] += step[l][k];
+			target[l % DEQ_CHANNELS].setSection(l / DEQ_CHANNELS,
+					cur[l][0], cur[l][1], cur[l][2], 1., cur[l][3], cur[l][4]);
+		}
+
+		for (c = 0; c < DEQ_CHANNELS; c++)
+			in[c] = target[c].tick(in[c]);
+		if (ms) {
+			double left = in[0] + in[1];
+			in[1] = in[0] - in[1];
+			in[0] = left;
 		}
-		outputs[0][i] = (float) out;
+		for (c = 0; c < DEQ_CHANNELS; c++)
+			outputs[c][i] = (float) in[c];
 	}
 }
 
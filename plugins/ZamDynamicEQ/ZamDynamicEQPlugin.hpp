@@ -18,16 +18,49 @@
 
 #include "DistrhoPlugin.hpp"
 #include <algorithm>
+#include <stdio.h>
+#include <float.h>
+#include "../../dsp/ZamBiquad.hpp"
 
 START_NAMESPACE_DISTRHO
 
 #define MAX_SAMPLES 12
 
+/* ZamDynamicEQX2 builds this same plugin in stereo */
+#define DEQ_CHANNELS DISTRHO_PLUGIN_NUM_OUTPUTS
+
+#define DEQ_NODES 4		/* node 1 uses the original controls */
+#define DEQ_EXTRANODES (DEQ_NODES - 1)
+#define DEQ_LANES (DEQ_NODES * DEQ_CHANNELS)	/* lane n * DEQ_CHANNELS + c */
+
+#define DEQ_CONTROL 16		/* samples between target filter updates */
+#define DEQ_TABDB 10		/* table spans +-DEQ_TABDB, the widest Max Boost/Cut */
+#define DEQ_TABSTEP 4		/* table entries per dB */
+#define DEQ_TABSIZE (2 * DEQ_TABDB * DEQ_TABSTEP + 1)
+
+#define TARGET_OFF 0
+#define TARGET_LOW 1
+#define TARGET_PEAK 2
+#define TARGET_HIGH 3
+
 // -----------------------------------------------------------------------
 
 class ZamDynamicEQPlugin : public Plugin
 {
 public:
+    // Layout of each per-node parameter block for nodes 2 and up
+    enum NodeParameters
+    {
+        nodeType = 0,
+        nodeDetectFreq,
+        nodeTargetFreq,
+        nodeTargetWidth,
+        nodeThresh,
+        nodeBoostCut,
+        nodeControlGain,
+        nodeParamCount
+    };
+
     enum Parameters
     {
         paramAttack = 0,
@@ -46,7 +79,15 @@ public:
         paramTargetWidth,
         paramBoostCut,
         paramControlGain,
+
+        paramNodeStart,
+#if DEQ_CHANNELS > 1
+        paramLink = paramNodeStart + DEQ_EXTRANODES * nodeParamCount,
+        paramMidSide,
         paramCount
+#else
+        paramCount = paramNodeStart + DEQ_EXTRANODES * nodeParamCount
+#endif
     };
 
     ZamDynamicEQPlugin();
@@ -57,12 +98,16 @@ protected:
 
     const char* getLabel() const noexcept override
     {
-        return "ZamDynamicEQ";
+        return DISTRHO_PLUGIN_NAME;
     }
 
     const char* getDescription() const noexcept override
     {
-        return "Mono dynamic EQ";
+#if DEQ_CHANNELS == 1
+        return "Mono dynamic EQ with four nodes, each with its own detector band, threshold and target filter";
+#else
+        return "Stereo dynamic EQ with four nodes, each with its own detector band, threshold and target filter, with linked or independent detection in left/right or mid/side";
+#endif
     }
 
     const char* getMaker() const noexcept override
@@ -87,7 +132,11 @@ protected:
 
     int64_t getUniqueId() const noexcept override
     {
+#if DEQ_CHANNELS == 1
         return d_cconst('Z', 'M', 'D', 'Q');
+#else
+        return d_cconst('Z', 'D', 'Q', '0' + DEQ_CHANNELS);
+#endif
     }
 
     // -------------------------------------------------------------------
@@ -95,6 +144,9 @@ protected:
 
     void initParameter(uint32_t index, Parameter& parameter) ;
     void initProgramName(uint32_t index, String& programName) ;
+    void initNodeParameter(uint32_t index, Parameter& parameter);
+    float getNodeParameter(uint32_t index) const;
+    void setNodeParameter(uint32_t index, float value);
 
     // -------------------------------------------------------------------
     // Internal data
@@ -128,54 +180,77 @@ protected:
     void highshelfeq(double, double G, double, double w0, double, double q, double B[], double A[]);
     void lowshelfeq(double, double G, double, double w0, double, double q, double B[], double A[]);
 
-    void run_comp(double input, double* output);
+    void run_comp(const float in[DEQ_LANES], float cdb[DEQ_LANES]);
     // -------------------------------------------------------------------
 
     void activate() override;
     void run(const float** inputs, float** outputs, uint32_t frames) override;
     void initAudioPort(bool input, uint32_t index, AudioPort& port) override;
 
-	void run_highshelf(double input, double* output);
-	void run_lowshelf(double input, double* output);
 	void run_peq1(double input, double* output);
-	void run_peq2(double input, double* output);
+
+	void set_table(int n, float srate);
+	void set_entry(int n, int k);
+	void lookup_table(int n, float gdb, double c[5]);
 
     // -------------------------------------------------------------------
 
 private:
 
-	void reset_low(void);
-	void reset_high(void);
-	void reset_peak(void);
+	void reset_target(int n);
 	
+	/* One detector per node and channel, each as a lane of the same filter */
 	struct linear_svf {
-		float g, k;
-		float a[3];
+		float g[DEQ_LANES], k[DEQ_LANES];
+		float a[3][DEQ_LANES];
 		float m[3];
 
-		float s[2][2];
+		float s[2][2][DEQ_LANES];
 	};
 
 	struct linear_svf bandpass;
 
-	void linear_svf_set_params(struct linear_svf *self,
+	void linear_svf_set_params(struct linear_svf *self, int n,
 			float sample_rate, float cutoff, float resonance);
 	void linear_svf_reset(struct linear_svf *self);
-	float run_linear_svf(struct linear_svf *self, int c, float in);
+	void run_linear_svf(struct linear_svf *self, int c,
+			const float in[DEQ_LANES], float out[DEQ_LANES]);
 
     float attack,release,knee,ratio,thresdb,max,slewfactor,sidechain, toglow, togpeak, toghigh, detectfreq, targetfreq, targetwidth, boostcut, controlgain; //parameters
-    float oldL_yl, oldL_y1, oldL_yg;
+    float link, midside; //stereo parameters
+    float oldL_yl[DEQ_LANES], oldL_y1[DEQ_LANES], oldL_yg[DEQ_LANES];
+
+    /* Node settings, node 1 is filled in from the original controls */
+    float nodetype[DEQ_NODES], nodedetect[DEQ_NODES], nodetarget[DEQ_NODES];
+    float nodewidth[DEQ_NODES], nodethresh[DEQ_NODES], nodeboostcut[DEQ_NODES];
+    float nodegain[DEQ_NODES];
 
-    double x1,x2,y1,y2;
-    double x1a,x2a,y1a,y2a;
-    double zln1,zln2,zld1,zld2;
-    double zhn1,zhn2,zhd1,zhd2;
     double a0x,a1x,a2x,b0x,b1x,b2x,gainx;
-    double a0y,a1y,a2y,b0y,b1y,b2y,gainy;
-    double Bl[3];
-    double Al[3];
-    double Bh[3];
-    double Ah[3];
+    float attack_coeff, release_coeff, slew_coeff;
+
+    /*
+     * Target filter coefficients b0 b1 b2 a1 a2 for each gain in the
+     * table. A change of type, frequency or width only marks the table
+     * stale, and lookups design the entries they land on, so automating
+     * those controls costs a couple of designs per lane per control
+     * period rather than the whole table. The filter moves in a straight
+     * line from one table lookup to the next every DEQ_CONTROL samples,
+     * which keeps it stable since each lookup and every point between two
+     * of them is a stable section.
+     */
+    double tab[DEQ_NODES][DEQ_TABSIZE][5];
+    uint32_t tabstamp[DEQ_NODES][DEQ_TABSIZE], tabgen[DEQ_NODES];
+    int tabtype[DEQ_NODES];
+    float tabfreq[DEQ_NODES], tabwidth[DEQ_NODES], tabsrate[DEQ_NODES];
+    double cur[DEQ_LANES][5], step[DEQ_LANES][5], next[DEQ_LANES][5];
+    float curgain[DEQ_LANES], nextgain[DEQ_LANES];
+    int ctl;
+
+    /*
+     * The target filters in series, one section per node. Each channel
+     * has its own cascade since unlinked channels get their own gains.
+     */
+    ZamBiquadCascade<double, 1, DEQ_NODES> target[DEQ_CHANNELS];
 };
 
 // -----------------------------------------------------------------------
@@ -21,8 +21,25 @@ START_NAMESPACE_DISTRHO
 
 // -----------------------------------------------------------------------
 
+/* Default centre frequencies of bands 5 and up */
+static const float bandfreqdef[EQ_EXTRABANDS] = {
+	32.f, 64.f, 125.f, 250.f, 500.f, 1000.f,
+	2000.f, 4000.f, 6000.f, 8000.f, 12000.f, 16000.f
+};
+
+/* Butterworth section Q for 12, 24 and 48 dB/oct */
+static const int butternsec[3] = { 1, 2, 4 };
+static const double butterq[3][EQ_BANDSECTIONS] = {
+	{ 0.70710678 },
+	{ 0.54119610, 1.30656296 },
+	{ 0.50979558, 0.60134489, 0.89997622, 2.56291545 }
+};
+
+// -----------------------------------------------------------------------
+
 ZamEQ2Plugin::ZamEQ2Plugin()
-    : Plugin(paramCount, 4, 0)
+    : Plugin(paramCount, 4, 0),
+      fir(EQ_CHANNELS)
 {
     // set default values
     loadProgram(0);
@@ -143,6 +160,119 @@ void ZamEQ2Plugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.min = 0.0f;
         parameter.ranges.max = 1.0f;
         break;
+    case paramLinear:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "Linear phase";
+        parameter.symbol     = "linphase";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    default:
+        initBandParameter(index, parameter);
+        break;
+    }
+}
+
+/* Bands 5 and up are laid out as blocks of bandParamCount parameters */
+void ZamEQ2Plugin::initBandParameter(uint32_t index, Parameter& parameter)
+{
+    char name[32], symbol[16];
+
+    if (index < paramBandStart || index >= paramCount)
+        return;
+
+    int k = (index - paramBandStart) / bandParamCount;
+
+    switch ((index - paramBandStart) % bandParamCount)
+    {
+    case bandType:
+        /* Off, Peak, Low shelf, High shelf, Lowpass 12/24/48 dB/oct,
+         * Highpass 12/24/48 dB/oct, Notch */
+        snprintf(name, sizeof(name), "Type %d", k + 5);
+        snprintf(symbol, sizeof(symbol), "type%d", k + 5);
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.unit       = " ";
+        parameter.ranges.def = typeOff;
+        parameter.ranges.min = typeOff;
+        parameter.ranges.max = typeCount - 1;
+        break;
+    case bandFreq:
+        snprintf(name, sizeof(name), "Frequency %d", k + 5);
+        snprintf(symbol, sizeof(symbol), "f%d", k + 5);
+        parameter.hints      = kParameterIsAutomable | kParameterIsLogarithmic;
+        parameter.unit       = "Hz";
+        parameter.ranges.def = bandfreqdef[k];
+        parameter.ranges.min = 20.0f;
+        parameter.ranges.max = 20000.0f;
+        break;
+    case bandGain:
+        snprintf(name, sizeof(name), "Boost/Cut %d", k + 5);
+        snprintf(symbol, sizeof(symbol), "boost%d", k + 5);
+        parameter.hints      = kParameterIsAutomable;
+        parameter.unit       = "dB";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = -50.0f;
+        parameter.ranges.max = 20.0f;
+        break;
+    case bandQ:
+        snprintf(name, sizeof(name), "Bandwidth %d", k + 5);
+        snprintf(symbol, sizeof(symbol), "bw%d", k + 5);
+        parameter.hints      = kParameterIsAutomable | kParameterIsLogarithmic;
+        parameter.unit       = " ";
+        parameter.ranges.def = 1.0f;
+        parameter.ranges.min = 0.1f;
+        parameter.ranges.max = 6.0f;
+        break;
+    }
+    parameter.name   = name;
+    parameter.symbol = symbol;
+}
+
+float ZamEQ2Plugin::getBandParameter(uint32_t index) const
+{
+    if (index < paramBandStart || index >= paramCount)
+        return 0.0f;
+
+    int k = (index - paramBandStart) / bandParamCount;
+
+    switch ((index - paramBandStart) % bandParamCount)
+    {
+    case bandType:
+        return bandtype[k];
+    case bandFreq:
+        return bandfreq[k];
+    case bandGain:
+        return bandgain[k];
+    case bandQ:
+        return bandq[k];
+    default:
+        return 0.0f;
+    }
+}
+
+void ZamEQ2Plugin::setBandParameter(uint32_t index, float value)
+{
+    if (index < paramBandStart || index >= paramCount)
+        return;
+
+    int k = (index - paramBandStart) / bandParamCount;
+
+    switch ((index - paramBandStart) % bandParamCount)
+    {
+    case bandType:
+        bandtype[k] = value;
+        break;
+    case bandFreq:
+        bandfreq[k] = value;
+        break;
+    case bandGain:
+        bandgain[k] = value;
+        break;
+    case bandQ:
+        bandq[k] = value;
+        break;
     }
 }
 
@@ -224,6 +354,13 @@ void ZamEQ2Plugin::loadProgram(uint32_t index)
 		togglepeaks = 0.0;
 		break;
 	}
+	linear = 0.0;
+	for (int k = 0; k < EQ_EXTRABANDS; k++) {
+		bandtype[k] = typeOff;
+		bandfreq[k] = bandfreqdef[k];
+		bandgain[k] = 0.0;
+		bandq[k] = 1.0;
+	}
     /* reset filter values */
     activate();
 }
@@ -271,8 +408,11 @@ float ZamEQ2Plugin::getParameterValue(uint32_t index) const
     case paramTogglePeaks:
         return togglepeaks;
         break;
+    case paramLinear:
+        return linear;
+        break;
     default:
-        return 0.0f;
+        return getBandParameter(index);
     }
 }
 
@@ -316,6 +456,12 @@ void ZamEQ2Plugin::setParameterValue(uint32_t index, float value)
     case paramTogglePeaks:
         togglepeaks = value;
         break;
+    case paramLinear:
+        linear = value;
+        break;
+    default:
+        setBandParameter(index, value);
+        break;
     }
 }
 
@@ -324,19 +470,24 @@ void ZamEQ2Plugin::setParameterValue(uint32_t index, float value)
 
 void ZamEQ2Plugin::activate()
 {
-        x1=x2=y1=y2=0.f;
-        x1a=x2a=y1a=y2a=0.f;
         a0x=a1x=a2x=b0x=b1x=b2x=gainx=0.f;
         a0y=a1y=a2y=b0y=b1y=b2y=gainy=0.f;
-        zln1=zln2=zld1=zld2=0.f;
-        zhn1=zhn2=zhd1=zhd2=0.f;
-
         int i;
 	for (i = 0; i < 3; ++i) {
                 Bl[i] = Al[i] = Bh[i] = Ah[i] = 0.f;
-                Bl[i] = Al[i] = Bh[i] = Ah[i] = 0.f;
-                Bl[i] = Al[i] = Bh[i] = Ah[i] = 0.f;
         }
+        eq.reset();
+
+        /* The FIR is only designed here if linear phase is already on */
+        set_filters(getSampleRate());
+        if (linear > 0.5f) {
+                curve.copySections(eq);
+                fir.init(getSampleRate(), curve);
+        } else {
+                fir.init(getSampleRate());
+        }
+        oldlinear = -1;
+        oldwant = 1;
 }
 
 void ZamEQ2Plugin::peq(double G0, double G, double GB, double w0, double Dw,
@@ -421,9 +572,69 @@ void ZamEQ2Plugin::highshelfeq(double, double G, double, double w0, double, doub
         A[2] = a2/a0;
 }
 
-void ZamEQ2Plugin::run(const float** inputs, float** outputs, uint32_t frames)
+/*
+ * Design the sections of extra band k and switch off the ones it leaves
+ * unused. A flat peak or shelf keeps running at 0 dB until it has rung out.
+ */
+void ZamEQ2Plugin::set_band(int k, float srate)
+{
+        int sec = SEC_BANDS + k * EQ_BANDSECTIONS;
+        int type = (int)bandtype[k];
+        double fc = std::min(bandfreq[k], 0.45f * srate);
+        double w0 = 2.f*M_PI*fc / srate;
+        double qq = pow(2.0, 1.0/bandq[k])/(pow(2.0, bandq[k]) - 1.0); //q from octave bw
+        double boost = from_dB(bandgain[k]);
+        double B[3], A[3];
+        double a0,a1,a2,b0,b1,b2,gn;
+        int i, n = 0;
+
+        switch (type) {
+        case typePeak:
+                if (bandgain[k] == 0.f && eq.settled(sec))
+                        break;
+                peq(1.f,boost,sqrt(boost),w0,fc / srate / qq,&a0,&a1,&a2,&b0,&b1,&b2,&gn);
+                eq.setSection(sec, b0, b1, b2, a0, a1, a2);
+                n = 1;
+                break;
+        case typeLowShelf:
+                if (bandgain[k] == 0.f && eq.settled(sec))
+                        break;
+                lowshelfeq(0.f,bandgain[k],to_dB(sqrt(boost)),w0,w0,0.707f,B,A);
+                eq.setSection(sec, B[0], B[1], B[2], A[0], A[1], A[2]);
+                n = 1;
+                break;
+        case typeHighShelf:
+                if (bandgain[k] == 0.f && eq.settled(sec))
+                        break;
+                highshelfeq(0.f,bandgain[k],to_dB(sqrt(boost)),w0,w0,0.707f,B,A);
+                eq.setSection(sec, B[0], B[1], B[2], A[0], A[1], A[2]);
+                n = 1;
+                break;
+        case typeLowpass12:
+        case typeLowpass24:
+        case typeLowpass48:
+                n = butternsec[type - typeLowpass12];
+                for (i = 0; i < n; i++)
+                        eq.setLowpass(sec + i, fc, srate, butterq[type - typeLowpass12][i]);
+                break;
+        case typeHighpass12:
+        case typeHighpass24:
+        case typeHighpass48:
+                n = butternsec[type - typeHighpass12];
+                for (i = 0; i < n; i++)
+                        eq.setHighpass(sec + i, fc, srate, butterq[type - typeHighpass12][i]);
+                break;
+        case typeNotch:
+                eq.setNotch(sec, fc, srate, qq);
+                n = 1;
+                break;
+        }
+        for (i = 0; i < EQ_BANDSECTIONS; i++)
+                eq.setActive(sec + i, i < n);
+}
+
+void ZamEQ2Plugin::set_filters(float srate)
 {
-	float srate = getSampleRate();
         double dcgain = 1.f;
 
         double qq1 = pow(2.0, 1.0/q1)/(pow(2.0, q1) - 1.0); //q from octave bw
@@ -455,64 +666,59 @@ void ZamEQ2Plugin::run(const float** inputs, float** outputs, uint32_t frames)
         lowshelfeq(0.f,gainl,bwgaindbl,2.f*M_PI*freql/srate,bwl,0.707f,Bl,Al);
         highshelfeq(0.f,gainh,bwgaindbh,2.f*M_PI*freqh/srate,bwh,0.707f,Bh,Ah);
 
-        for (uint32_t i = 0; i < frames; i++) {
-                double tmp,tmpl, tmph;
-                double in = inputs[0][i];
-                x1 = sanitize_denormal(x1);
-                x2 = sanitize_denormal(x2);
-                y1 = sanitize_denormal(y1);
-                y2 = sanitize_denormal(y2);
-                x1a = sanitize_denormal(x1a);
-                x2a = sanitize_denormal(x2a);
-                y1a = sanitize_denormal(y1a);
-                y2a = sanitize_denormal(y2a);
-                zln1 = sanitize_denormal(zln1);
-                zln2 = sanitize_denormal(zln2);
-                zld1 = sanitize_denormal(zld1);
-                zld2 = sanitize_denormal(zld2);
-                zhn1 = sanitize_denormal(zhn1);
-                zhn2 = sanitize_denormal(zhn2);
-                zhd1 = sanitize_denormal(zhd1);
-                zhd2 = sanitize_denormal(zhd2);
-                in = sanitize_denormal(in);
-
-                //lowshelf
-                tmpl = in * Bl[0] +
-                        zln1 * Bl[1] +
-                        zln2 * Bl[2] -
-                        zld1 * Al[1] -
-                        zld2 * Al[2];
-                zln2 = zln1;
-                zld2 = zld1;
-                zln1 = in;
-                zld1 = tmpl;
-
-                //highshelf
-                tmph = tmpl * Bh[0] +
-                        zhn1 * Bh[1] +
-                        zhn2 * Bh[2] -
-                        zhd1 * Ah[1] -
-                        zhd2 * Ah[2];
-                zhn2 = zhn1;
-                zhd2 = zhd1;
-                zhn1 = tmpl; 
-                zhd1 = tmph; 
-
-                //parametric1
-                tmp = tmph * b0x + x1 * b1x + x2 * b2x - y1 * a1x - y2 * a2x;
-                x2 = x1;
-                y2 = y1;
-                x1 = tmph;
-                y1 = tmp;
-
-                //parametric2
-                outputs[0][i] = tmp * b0y + x1a * b1y + x2a * b2y - y1a * a1y - y2a * a2y;
-                x2a = x1a;
-                y2a = y1a;
-                x1a = tmp;
-                y1a = outputs[0][i];
-
-                outputs[0][i] *= from_dB(master);
+        eq.setSection(SEC_LOW, Bl[0], Bl[1], Bl[2], Al[0], Al[1], Al[2]);
+        eq.setSection(SEC_HIGH, Bh[0], Bh[1], Bh[2], Ah[0], Ah[1], Ah[2]);
+        eq.setSection(SEC_PEAK1, b0x, b1x, b2x, a0x, a1x, a2x);
+        eq.setSection(SEC_PEAK2, b0y, b1y, b2y, a0y, a1y, a2y);
+
+        /* Flat bands are exact passthroughs, leave them out once they have rung out */
+        eq.setActive(SEC_LOW, gainl != 0.f || !eq.settled(SEC_LOW));
+        eq.setActive(SEC_HIGH, gainh != 0.f || !eq.settled(SEC_HIGH));
+        eq.setActive(SEC_PEAK1, gain1 != 0.f || !eq.settled(SEC_PEAK1));
+        eq.setActive(SEC_PEAK2, gain2 != 0.f || !eq.settled(SEC_PEAK2));
+        for (int k = 0; k < EQ_EXTRABANDS; k++)
+                set_band(k, srate);
+}
+
+void ZamEQ2Plugin::run(const float** inputs, float** outputs, uint32_t frames)
+{
+        set_filters(getSampleRate());
+
+        /*
+         * Linear phase takes over once the FIR matches the current settings
+         * and has a full history. Until then the IIR keeps playing with no
+         * latency and the FIR is only fed.
+         */
+        int wantlinear = (linear > 0.5f) ? 1 : 0;
+        if (wantlinear) {
+                if (!oldwant)
+                        fir.reset();
+                curve.copySections(eq);
+                fir.update(curve);
+        }
+        oldwant = wantlinear;
+
+        int linearmode = (wantlinear && (oldlinear == 1 || fir.current())) ? 1 : 0;
+        if (linearmode != oldlinear) {
+                if (!linearmode)
+                        eq.reset();
+                setLatency(linearmode ? fir.getLatency() : 0);
+                oldlinear = linearmode;
+        }
+
+        if (linearmode) {
+                fir.process(inputs, outputs, frames);
+        } else {
+                if (wantlinear)
+                        fir.process(inputs, NULL, frames);
+                eq.process(inputs, outputs, frames);
+        }
+
+        float mastergain = from_dB(master);
+        for (int c = 0; c < EQ_CHANNELS; c++) {
+                for (uint32_t i = 0; i < frames; i++) {
+                        outputs[c][i] *= mastergain;
+                }
 	}
 }
 
@@ -17,6 +17,18 @@
 #define ZAMEQ2PLUGIN_HPP_INCLUDED
 
 #include "DistrhoPlugin.hpp"
+#include <algorithm>
+#include <stdio.h>
+#include "../../dsp/ZamBiquad.hpp"
+#include "../../dsp/ZamFIREQ.hpp"
+
+/* ZamEQ2X2 and ZamEQ2X8 build this same plugin with more channels */
+#define EQ_CHANNELS DISTRHO_PLUGIN_NUM_OUTPUTS
+
+#define EQ_MAXBANDS 16
+#define EQ_FIXEDBANDS 4		/* low and high shelf, peak 1 and 2 */
+#define EQ_EXTRABANDS (EQ_MAXBANDS - EQ_FIXEDBANDS)
+#define EQ_BANDSECTIONS 4	/* biquads per extra band, for 48 dB/oct */
 
 START_NAMESPACE_DISTRHO
 
@@ -25,6 +37,32 @@ START_NAMESPACE_DISTRHO
 class ZamEQ2Plugin : public Plugin
 {
 public:
+    // Layout of each per-band parameter block for bands 5 and up
+    enum BandParameters
+    {
+        bandType = 0,
+        bandFreq,
+        bandGain,
+        bandQ,
+        bandParamCount
+    };
+
+    enum BandTypes
+    {
+        typeOff = 0,
+        typePeak,
+        typeLowShelf,
+        typeHighShelf,
+        typeLowpass12,
+        typeLowpass24,
+        typeLowpass48,
+        typeHighpass12,
+        typeHighpass24,
+        typeHighpass48,
+        typeNotch,
+        typeCount
+    };
+
     enum Parameters
     {
         paramGain1 = 0,
@@ -39,7 +77,10 @@ public:
         paramFreqH,
         paramMaster,
         paramTogglePeaks,
-        paramCount
+        paramLinear,
+
+        paramBandStart,
+        paramCount = paramBandStart + EQ_EXTRABANDS * bandParamCount
     };
 
     ZamEQ2Plugin();
@@ -50,12 +91,16 @@ protected:
 
     const char* getLabel() const noexcept override
     {
-        return "ZamEQ2";
+        return DISTRHO_PLUGIN_NAME;
     }
 
     const char* getDescription() const noexcept override
     {
-        return "Two band parametric equaliser with high and low shelving circuits.";
+#if EQ_CHANNELS == 1
+        return "Two band parametric equaliser with high and low shelving circuits, plus twelve more bands of selectable type.";
+#else
+        return "Two band parametric equaliser with high and low shelving circuits, plus twelve more bands of selectable type, multichannel version.";
+#endif
     }
 
     const char* getMaker() const noexcept override
@@ -80,7 +125,11 @@ protected:
 
     int64_t getUniqueId() const noexcept override
     {
+#if EQ_CHANNELS == 1
         return d_cconst('Z', 'E', 'Q', '2');
+#else
+        return d_cconst('Z', 'Q', '2', '0' + EQ_CHANNELS);
+#endif
     }
 
     // -------------------------------------------------------------------
@@ -96,6 +145,10 @@ protected:
     void  setParameterValue(uint32_t index, float value) override;
     void  loadProgram(uint32_t index) override;
 
+    void initBandParameter(uint32_t index, Parameter& parameter);
+    float getBandParameter(uint32_t index) const;
+    void setBandParameter(uint32_t index, float value);
+
     // -------------------------------------------------------------------
     // Process
 
@@ -131,20 +184,37 @@ protected:
     		double w0, double Dw, double q, double B[], double A[]);
     void highshelfeq(double G0, double G, double GB,
     		double w0, double Dw, double q, double B[], double A[]);
+    void set_band(int k, float srate);
+    void set_filters(float srate);
     // -------------------------------------------------------------------
 
 private:
-    float gain1,q1,freq1,gain2,q2,freq2,gainl,freql,gainh,freqh,master,togglepeaks; //parameters
-        double x1,x2,y1,y2;
-        double x1a,x2a,y1a,y2a;
-        double zln1,zln2,zld1,zld2;
-        double zhn1,zhn2,zhd1,zhd2;
+    float gain1,q1,freq1,gain2,q2,freq2,gainl,freql,gainh,freqh,master,togglepeaks,linear; //parameters
         double a0x,a1x,a2x,b0x,b1x,b2x,gainx;
         double a0y,a1y,a2y,b0y,b1y,b2y,gainy;
         double Bl[3];
         double Al[3];
         double Bh[3];
         double Ah[3];
+
+        /* Bands 5 and up, by band type */
+        float bandtype[EQ_EXTRABANDS], bandfreq[EQ_EXTRABANDS];
+        float bandgain[EQ_EXTRABANDS], bandq[EQ_EXTRABANDS];
+
+        /*
+         * Low shelf, high shelf, peak 1, peak 2, then EQ_BANDSECTIONS
+         * sections for each extra band. Bands that are off or at 0 dB are
+         * switched off in the cascade so they cost nothing per sample.
+         */
+        enum { SEC_LOW = 0, SEC_HIGH, SEC_PEAK1, SEC_PEAK2, SEC_BANDS,
+               SECTIONS = SEC_BANDS + EQ_EXTRABANDS * EQ_BANDSECTIONS };
+        ZamBiquadCascade<double, EQ_CHANNELS, SECTIONS> eq;
+
+        /* Linear phase mode renders the response of eq as one FIR */
+        typedef ZamBiquadCascade<double, 1, SECTIONS> Curve;
+        Curve curve;
+        ZamFIREQ<Curve> fir;
+        int oldlinear, oldwant;
 };
 
 // -----------------------------------------------------------------------
@@ -22,7 +22,9 @@ START_NAMESPACE_DISTRHO
 // -----------------------------------------------------------------------
 
 ZamGEQ31Plugin::ZamGEQ31Plugin()
-    : Plugin(paramCount, 1, 0) // 1 program, 0 states
+    : Plugin(paramCount, 1, 0), // 1 program, 0 states
+      firmin(GEQ_CHANNELS, FIREQ_MINIMUM, 32768),
+      firlin(GEQ_CHANNELS, FIREQ_LINEAR, 32768)
 {
     // set default values
     loadProgram(0);
@@ -305,6 +307,25 @@ void ZamGEQ31Plugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.min = -12.0f;
         parameter.ranges.max = 12.0f;
         break;
+    case paramMultirate:
+        parameter.hints      = kParameterIsAutomable | kParameterIsBoolean;
+        parameter.name       = "Multirate low bands";
+        parameter.symbol     = "multirate";
+        parameter.unit       = " ";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+    case paramFIR:
+        /* Off, minimum phase, linear phase */
+        parameter.hints      = kParameterIsAutomable | kParameterIsInteger;
+        parameter.name       = "Single FIR";
+        parameter.symbol     = "fir";
+        parameter.unit       = " ";
+        parameter.ranges.def = FIR_OFF;
+        parameter.ranges.min = FIR_OFF;
+        parameter.ranges.max = FIR_LINEAR;
+        break;
     }
 }
 
@@ -413,6 +434,12 @@ float ZamGEQ31Plugin::getParameterValue(uint32_t index) const
     case paramGain29:
         return gain[28];
         break;
+    case paramMultirate:
+        return multirate;
+        break;
+    case paramFIR:
+        return firmode;
+        break;
     default:
         return 0.0f;
     }
@@ -512,6 +539,12 @@ void ZamGEQ31Plugin::setParameterValue(uint32_t index, float value)
     case paramGain29:
         gain[28] = value;
         break;
+    case paramMultirate:
+        multirate = value;
+        break;
+    case paramFIR:
+        firmode = value;
+        break;
     }
 }
 
@@ -556,46 +589,96 @@ void ZamGEQ31Plugin::geq(int i, float srate, float g)
 		alpham = (0.5 - (2. * mm - 1) / (2. * m[i])) * M_PI;
 		cm[i][mm] = cos(alpham);
 		a0m[i][mm] = 1. / (1. + 2. * k[i]*cm[i][mm] + k[i]*k[i]);
+		sectioncoeffs(i, mm);
 	}
 }
 
-double ZamGEQ31Plugin::run_filter(int i, double in)
+/*
+ * Folds the fourth order section into out = g*in + h1*a1out + h2*a2out,
+ * where the allpass outputs depend only on the state. The input then
+ * passes through each section with a single multiply-add, which keeps the
+ * chain of sections short enough for consecutive samples to overlap.
+ */
+void ZamGEQ31Plugin::sectioncoeffs(int i, int j)
+{
+	double c1 = -2. * v[i] * cm[i][j];
+	double c2 = v[i] * (2. + v[i]) * k[i];
+	double e1 = 1. - 2. * k[i] * cm[i][j] + k[i] * k[i];
+	double e2 = 2. * k[i] * k[i] - 2.;
+	double d = (c2 - c1) * a0m[i][j];
+
+	sg[i][j] = 1. + d * k[i];
+	sh1[i][j] = 2. * c2 - d * e2;
+	sh2[i][j] = c1 + c2 - d * e1;
+	sp[i][j] = a0m[i][j] * k[i];
+	sq1[i][j] = -a0m[i][j] * e2;
+	sq2[i][j] = -a0m[i][j] * e1;
+}
+
+/*
+ * Runs band i over a whole chunk before the next band is touched, with
+ * the band's coefficients and state copied into locals for the chunk.
+ * Each frame holds one sample per channel, and every step of a section
+ * is a loop across those channels with the same coefficients.
+ */
+void ZamGEQ31Plugin::run_band(int i, geqsample_t (*buf)[GEQ_CHANNELS], uint32_t frames)
 {
-	int j;
-        double out, a1out, a2out, v1, v2;
-        in = sanitize_denormal(in);
-	a1out = 0.;
-	a2out = 0.;
-	v1 = v2 = 0.;
-	out = in;
-
-	// higher order
-	for (j = 1; j <= m[i] / 2; j++) {
-
-		// allpass 1
-		a1out = a[i]*(w11[i][j] + a[i]*w12[i][j]) - w12[i][j];
-
-		// allpass 2
-		a2out = a[i]*(w21[i][j] + a[i]*w22[i][j]) - w22[i][j];
-
-		// intermediate values
-		v1 = (a2out - 2. * a1out) + k[i]*(2. * (-cm[i][j]) * a2out +
-			k[i]*(2. * a1out + a2out));
-		v2 = a2out + 2. * a1out;
-
-		// 4th order output section
-		out = in + v[i] * 2. * (-cm[i][j])*(-a0m[i][j]*(k[i]*in - v1) + a2out) +
-			v[i]*(2. + v[i])*k[i]*(a0m[i][j]*(k[i]*in - v1) + v2);
-		
-		// update state
-		w12[i][j] = w11[i][j] + a[i]*w12[i][j];
-		w11[i][j] = a0m[i][j]*(k[i]*in - v1);
-		w22[i][j] = w21[i][j] + a[i]*w22[i][j];
-		w21[i][j] = a1out;
-		
-		in = out;
+	int j, c, nsec = m[i] / 2;
+	uint32_t s;
+	const geqsample_t ai = a[i];
+	geqsample_t g[21], h1[21], h2[21], p[21], q1[21], q2[21];
+	geqsample_t s11[21][GEQ_CHANNELS], s12[21][GEQ_CHANNELS];
+	geqsample_t s21[21][GEQ_CHANNELS], s22[21][GEQ_CHANNELS];
+
+	for (j = 1; j <= nsec; j++) {
+		g[j] = sg[i][j];
+		h1[j] = sh1[i][j];
+		h2[j] = sh2[i][j];
+		p[j] = sp[i][j];
+		q1[j] = sq1[i][j];
+		q2[j] = sq2[i][j];
+		for (c = 0; c < GEQ_CHANNELS; c++) {
+			s11[j][c] = w11[i][j][c];
+			s12[j][c] = w12[i][j][c];
+			s21[j][c] = w21[i][j][c];
+			s22[j][c] = w22[i][j][c];
+		}
+	}
+
+	for (s = 0; s < frames; s++) {
+		geqsample_t in[GEQ_CHANNELS];
+		for (c = 0; c < GEQ_CHANNELS; c++)
+			in[c] = sanitize_denormal(buf[s][c]);
+
+		// higher order
+		for (j = 1; j <= nsec; j++) {
+			for (c = 0; c < GEQ_CHANNELS; c++) {
+				// allpass 1 and 2
+				geqsample_t a1out = ai*(s11[j][c] + ai*s12[j][c]) - s12[j][c];
+				geqsample_t a2out = ai*(s21[j][c] + ai*s22[j][c]) - s22[j][c];
+
+				// update state
+				s12[j][c] = s11[j][c] + ai*s12[j][c];
+				s11[j][c] = p[j]*in[c] + q1[j]*a1out + q2[j]*a2out;
+				s22[j][c] = s21[j][c] + ai*s22[j][c];
+				s21[j][c] = a1out;
+
+				// 4th order output section
+				in[c] = g[j]*in[c] + h1[j]*a1out + h2[j]*a2out;
+			}
+		}
+		for (c = 0; c < GEQ_CHANNELS; c++)
+			buf[s][c] = in[c];
+	}
+
+	for (j = 1; j <= nsec; j++) {
+		for (c = 0; c < GEQ_CHANNELS; c++) {
+			w11[i][j][c] = s11[j][c];
+			w12[i][j][c] = s12[j][c];
+			w21[i][j][c] = s21[j][c];
+			w22[i][j][c] = s22[j][c];
+		}
 	}
-	return out;
 }
 
 void ZamGEQ31Plugin::loadProgram(uint32_t index)
@@ -670,6 +753,8 @@ void ZamGEQ31Plugin::loadProgram(uint32_t index)
     omegaU[28] = 22400.;
 
     master = 0.f;
+    multirate = 0.f;
+    firmode = FIR_OFF;
     float srate = getSampleRate();
     for (i = 0; i < 29; ++i) {
         geq(i, srate, 0.);
@@ -685,16 +770,169 @@ void ZamGEQ31Plugin::loadProgram(uint32_t index)
 
 void ZamGEQ31Plugin::activate()
 {
-    int i, j;
+    int i;
+    for (i = 0; i < 29; i++)
+        reset_band(i);
+
+    init_multirate(getSampleRate());
+
+    /* Only the FIR of the selected mode is designed here, the other on first use */
+    float srate = getSampleRate();
+    for (i = 0; i < 29; i++) {
+        geq(i, srate, gain[i]);
+        gainold[i] = gain[i];
+    }
+    int want = std::min(std::max((int)(firmode + 0.5f), (int)FIR_OFF), (int)FIR_LINEAR);
+    set_curve();
+    if (want == FIR_MINIMUM)
+        firmin.init(srate, curve);
+    else
+        firmin.init(srate);
+    if (want == FIR_LINEAR)
+        firlin.init(srate, curve);
+    else
+        firlin.init(srate);
+    oldfir = -1;
+    oldwant = want;
+    oldlatency = -1;
+}
+
+/*
+ * Snapshot of the full rate coefficients of every band in use. While
+ * multirate runs, an FIR can be warming up, so the decimated low bands
+ * are redesigned at the full rate for the snapshot and then restored.
+ */
+void ZamGEQ31Plugin::set_curve()
+{
+    float srate = getSampleRate();
+    int i, j, b = 0;
+
+    memset(&curve, 0, sizeof(curve));
     for (i = 0; i < 29; i++) {
-        for (j = 0; j < 21; j++) {
-            w11[i][j] = 0.;
-            w12[i][j] = 0.;
-            w21[i][j] = 0.;
-            w22[i][j] = 0.;
+        bool low = (oldmultirate == 1 && i < MR_BANDS);
+        if (low)
+            geq(i, srate, gain[i]);
+        if (gain[i] == 0.f || m[i] == 0) {
+            if (low)
+                geq(i, srate / mr_factor, gain[i]);
+            continue;
         }
+        curve.a[b] = a[i];
+        curve.nsec[b] = m[i] / 2;
+        for (j = 0; j < m[i] / 2; j++) {
+            curve.g[b][j] = sg[i][j + 1];
+            curve.h1[b][j] = sh1[i][j + 1];
+            curve.h2[b][j] = sh2[i][j + 1];
+            curve.p[b][j] = sp[i][j + 1];
+            curve.q1[b][j] = sq1[i][j + 1];
+            curve.q2[b][j] = sq2[i][j + 1];
+        }
+        if (low)
+            geq(i, srate / mr_factor, gain[i]);
+        b++;
+    }
+    curve.nbands = b;
+}
+
+void ZamGEQ31Plugin::reset_band(int i)
+{
+    memset(w11[i], 0, sizeof(w11[i]));
+    memset(w12[i], 0, sizeof(w12[i]));
+    memset(w21[i], 0, sizeof(w21[i]));
+    memset(w22[i], 0, sizeof(w22[i]));
+}
+
+/*
+ * Picks the largest power of two decimation that keeps the reduced rate
+ * above MR_RATE, and designs the windowed sinc used both to decimate and
+ * to interpolate. Its cutoff is half the reduced rate; the low bands only
+ * change the signal well below that, so the wide transition is harmless.
+ */
+void ZamGEQ31Plugin::init_multirate(float srate)
+{
+    int n;
+    double sum = 0.;
+
+    mr_factor = 1;
+    while (srate / (2 * mr_factor) >= MR_RATE && mr_factor < MR_MAXFACTOR)
+        mr_factor *= 2;
+    mr_taps = 8 * mr_factor + 1;
+
+    for (n = 0; n < mr_taps; n++) {
+        double t = n - (mr_taps - 1) / 2.;
+        double fc = 0.5 / mr_factor;
+        double w = 0.42 - 0.5 * cos(2. * M_PI * n / (mr_taps - 1))
+            + 0.08 * cos(4. * M_PI * n / (mr_taps - 1));
+        mr_fir[n] = ((t == 0.) ? 2. * fc : sin(2. * M_PI * fc * t) / (M_PI * t)) * w;
+        sum += mr_fir[n];
     }
+    for (n = 0; n < mr_taps; n++)
+        mr_fir[n] /= sum;
 
+    memset(mr_hist, 0, sizeof(mr_hist));
+    memset(mr_diff, 0, sizeof(mr_diff));
+    mr_pos = mr_dpos = mr_phase = 0;
+    oldmultirate = -1;
+}
+
+void ZamGEQ31Plugin::run_multirate(geqsample_t (*buf)[GEQ_CHANNELS], uint32_t frames)
+{
+    geqsample_t low[GEQ_CHUNK][GEQ_CHANNELS], diff[GEQ_CHUNK][GEQ_CHANNELS];
+    const uint32_t start = mr_pos;
+    uint32_t s, nd, ph;
+    int j, t, c;
+
+    /* Lowpass, keeping every mr_factor-th sample */
+    nd = 0;
+    ph = mr_phase;
+    for (s = 0; s < frames; s++) {
+        for (c = 0; c < GEQ_CHANNELS; c++)
+            mr_hist[(start + s) & (MR_RING - 1)][c] = buf[s][c];
+        if (ph == 0) {
+            double acc[GEQ_CHANNELS] = { 0. };
+            for (t = 0; t < mr_taps; t++)
+                for (c = 0; c < GEQ_CHANNELS; c++)
+                    acc[c] += mr_fir[t] * mr_hist[(start + s - t) & (MR_RING - 1)][c];
+            for (c = 0; c < GEQ_CHANNELS; c++)
+                low[nd][c] = acc[c];
+            nd++;
+        }
+        if (++ph == (uint32_t)mr_factor)
+            ph = 0;
+    }
+
+    /* The low bands at the reduced rate, keeping only what they change */
+    memcpy(diff, low, nd * sizeof(low[0]));
+    for (j = 0; j < MR_BANDS; j++) {
+        if (gain[j] != 0.f)
+            run_band(j, diff, nd);
+    }
+    for (s = 0; s < nd; s++)
+        for (c = 0; c < GEQ_CHANNELS; c++)
+            diff[s][c] -= low[s][c];
+
+    /* Zero stuff and interpolate back, onto the input delayed to match */
+    nd = 0;
+    ph = mr_phase;
+    for (s = 0; s < frames; s++) {
+        double acc[GEQ_CHANNELS] = { 0. };
+        if (ph == 0) {
+            mr_dpos = (mr_dpos + 1) & (MR_DRING - 1);
+            for (c = 0; c < GEQ_CHANNELS; c++)
+                mr_diff[mr_dpos][c] = diff[nd][c];
+            nd++;
+        }
+        for (t = ph, j = 0; t < mr_taps; t += mr_factor, j++)
+            for (c = 0; c < GEQ_CHANNELS; c++)
+                acc[c] += mr_fir[t] * mr_diff[(mr_dpos - j) & (MR_DRING - 1)][c];
+        for (c = 0; c < GEQ_CHANNELS; c++)
+            buf[s][c] = mr_hist[(start + s - (mr_taps - 1)) & (MR_RING - 1)][c] + mr_factor * acc[c];
+        if (++ph == (uint32_t)mr_factor)
+            ph = 0;
+    }
+
+    mr_pos = (start + frames) & (MR_RING - 1);
+    mr_phase = ph;
 }
 
 void ZamGEQ31Plugin::run(const float** inputs, float** outputs, uint32_t frames)
@@ -702,28 +940,98 @@ void ZamGEQ31Plugin::run(const float** inputs, float** outputs, uint32_t frames)
 	float srate = getSampleRate();
 	
 	uint32_t i, j;
+	int c;
+	/*
+	 * The FIR of the selected mode only takes over once it matches the
+	 * current curve and has a full history. Until then it is only fed
+	 * and the path that was playing, IIR or the other FIR, carries on.
+	 */
+	int want = std::min(std::max((int)(firmode + 0.5f), (int)FIR_OFF), (int)FIR_LINEAR);
+	ZamFIREQ<ZamGEQ31Curve> *w = (want == FIR_MINIMUM) ? &firmin :
+					(want == FIR_LINEAR) ? &firlin : NULL;
+	if (w && want != oldwant && want != oldfir)
+		w->reset();
+	int fir = (oldfir < 0) ? FIR_OFF : oldfir;
+	if (!w || (want != fir && w->current()))
+		fir = want;
+	ZamFIREQ<ZamGEQ31Curve> *f = (fir == FIR_MINIMUM) ? &firmin :
+					(fir == FIR_LINEAR) ? &firlin : NULL;
+	int mr = (multirate > 0.5f && mr_factor > 1 && !f) ? 1 : 0;
+	if (mr != oldmultirate) {
+		/* The low bands move to the other rate and start over */
+		for (i = 0; i < MR_BANDS; i++) {
+			geq(i, mr ? srate / mr_factor : srate, gain[i]);
+			gainold[i] = gain[i];
+			reset_band(i);
+		}
+		oldmultirate = mr;
+	}
+	bool changed = false;
 	for (i = 0; i < 29; i++) {
 		if (gain[i] != gainold[i]) {
-			geq(i, srate, gain[i]);
+			geq(i, (mr && i < MR_BANDS) ? srate / mr_factor : srate, gain[i]);
 			gainold[i] = gain[i];
+			changed = true;
 		}
 	}
 
-	for (i = 0; i < frames; i++) {
-		double tmp, filtered;
-		double in = inputs[0][i];
-		in = sanitize_denormal(in);
-		tmp = in;
-		filtered = tmp;
-
-		for (j = 0; j < 29; j++) {
-			if (gain[j] != 0.f) {
-				filtered = run_filter(j, tmp);
-				tmp = filtered;
-			}
+	if (w && (changed || want != oldwant)) {
+		set_curve();
+		w->update(curve);
+		if (f && f != w)
+			f->update(curve);
+	} else if (f && changed) {
+		set_curve();
+		f->update(curve);
+	}
+	oldwant = want;
+
+	if (fir != oldfir) {
+		if (!f) {
+			for (i = 0; i < 29; i++)
+				reset_band(i);
 		}
-		outputs[0][i] = inputs[0][i];
-		outputs[0][i] = (float) (filtered * from_dB(master));
+		oldfir = fir;
+	}
+	int latency = f ? f->getLatency() : mr ? mr_taps - 1 : 0;
+	if (latency != oldlatency) {
+		setLatency(latency);
+		oldlatency = latency;
+	}
+
+	double mastergain = from_dB(master);
+	if (w && w != f)
+		w->process(inputs, NULL, frames);
+	if (f) {
+		f->process(inputs, outputs, frames);
+		for (c = 0; c < GEQ_CHANNELS; c++)
+			for (i = 0; i < frames; i++)
+				outputs[c][i] = (float) (outputs[c][i] * mastergain);
+		return;
+	}
+
+	/*
+	 * Band by band over chunks of the block, bands at 0 dB are skipped.
+	 * The channels are interleaved so each band runs them side by side.
+	 */
+	geqsample_t buf[GEQ_CHUNK][GEQ_CHANNELS];
+	uint32_t n, s;
+	for (i = 0; i < frames; i += n) {
+		n = std::min(frames - i, (uint32_t)GEQ_CHUNK);
+		for (c = 0; c < GEQ_CHANNELS; c++)
+			for (s = 0; s < n; s++)
+				buf[s][c] = sanitize_denormal(inputs[c][i + s]);
+
+		if (mr)
+			run_multirate(buf, n);
+		for (j = mr ? MR_BANDS : 0; j < 29; j++) {
+			if (gain[j] != 0.f)
+				run_band(j, buf, n);
+		}
+
+		for (c = 0; c < GEQ_CHANNELS; c++)
+			for (s = 0; s < n; s++)
+				outputs[c][i + s] = (float) (buf[s][c] * mastergain);
 	}
 }
 
@@ -17,13 +17,72 @@
 #define ZAMGEQ31PLUGIN_HPP_INCLUDED
 
 #include "DistrhoPlugin.hpp"
+#include <algorithm>
+#include <complex>
+#include <string.h>
+#include "../../dsp/ZamFIREQ.hpp"
+
+/* ZamGEQ31X2 builds this same plugin in stereo */
+#define GEQ_CHANNELS DISTRHO_PLUGIN_NUM_OUTPUTS
 
 #define MAX_FILT 31
+#define GEQ_CHUNK 256		/* frames filtered band by band at a time */
+
+#define MR_BANDS 10		/* 28 Hz to 282 Hz, optionally run decimated */
+#define MR_RATE 11000.f		/* lowest reduced rate */
+#define MR_MAXFACTOR 16
+#define MR_MAXTAPS (8 * MR_MAXFACTOR + 1)
+#define MR_RING 512		/* >= GEQ_CHUNK + MR_MAXTAPS, power of two */
+#define MR_DRING 16		/* >= MR_MAXTAPS / factor, power of two */
+
+#define FIR_OFF 0
+#define FIR_MINIMUM 1
+#define FIR_LINEAR 2
+
+/* Build with GEQ31_FLOAT=true to run the filter bank in single precision */
+#ifdef GEQ31_FLOAT
+typedef float geqsample_t;
+#else
+typedef double geqsample_t;
+#endif
 
 START_NAMESPACE_DISTRHO
 
 // -----------------------------------------------------------------------
 
+/*
+ * Coefficients of the bands in use, as the FIR mode sees them. Each
+ * fourth order section is out = g*in + h1*A*s + h2*A^2*s/z with
+ * z*s = p*in + q1*A*s + q2*A^2*s/z, where A is the band's allpass, so the
+ * response is exact without running the filters.
+ */
+struct ZamGEQ31Curve
+{
+	int nbands;
+	int nsec[29];
+	double a[29];
+	double g[29][20], h1[29][20], h2[29][20], p[29][20], q1[29][20], q2[29][20];
+
+	double magnitude(double w) const
+	{
+		const std::complex<double> z = std::polar(1., w), zi = 1. / z;
+		std::complex<double> h = 1.;
+		int b, j;
+
+		for (b = 0; b < nbands; b++) {
+			std::complex<double> ap = (a[b] * z - 1.) / (z - a[b]);
+			std::complex<double> ap2 = ap * ap * zi;
+			for (j = 0; j < nsec[b]; j++) {
+				h *= g[b][j] + p[b][j] * (h1[b][j] * ap + h2[b][j] * ap2) /
+					(z - q1[b][j] * ap - q2[b][j] * ap2);
+			}
+		}
+		return std::abs(h);
+	}
+};
+
+// -----------------------------------------------------------------------
+
 class ZamGEQ31Plugin : public Plugin
 {
 public:
@@ -59,6 +118,8 @@ public:
         paramGain27,
         paramGain28,
         paramGain29,
+        paramMultirate,
+        paramFIR,
         paramCount
     };
 
@@ -70,12 +131,16 @@ protected:
 
     const char* getLabel() const noexcept override
     {
-        return "ZamGEQ31";
+        return DISTRHO_PLUGIN_NAME;
     }
 
     const char* getDescription() const noexcept override
     {
+#if GEQ_CHANNELS == 1
         return "31 band graphic equaliser, good for eq of live spaces, removing unwanted noise from a track etc.";
+#else
+        return "31 band graphic equaliser, good for eq of live spaces, removing unwanted noise from a track etc, stereo version.";
+#endif
     }
 
     const char* getMaker() const noexcept override
@@ -100,7 +165,11 @@ protected:
 
     int64_t getUniqueId() const noexcept override
     {
+#if GEQ_CHANNELS == 1
         return d_cconst('Z', 'G', '3', '1');
+#else
+        return d_cconst('Z', 'G', 'X', '0' + GEQ_CHANNELS);
+#endif
     }
 
     // -------------------------------------------------------------------
@@ -145,14 +214,40 @@ protected:
     void run(const float** inputs, float** outputs, uint32_t frames) override;
 
     void geq(int i, float srate, float g);
-    double run_filter(int i, double in);
+    void sectioncoeffs(int i, int j);
+    void run_band(int i, geqsample_t (*buf)[GEQ_CHANNELS], uint32_t frames);
+    void reset_band(int i);
+    void init_multirate(float srate);
+    void run_multirate(geqsample_t (*buf)[GEQ_CHANNELS], uint32_t frames);
+    void set_curve();
         double omegaL[29], omegaU[29], k[29], v[29], a[29], cm[29][21], a0m[29][21];
+	double sg[29][21], sh1[29][21], sh2[29][21], sp[29][21], sq1[29][21], sq2[29][21];
 	int m[29];
-	double w11[29][21], w12[29][21], w21[29][21], w22[29][21];
+	/* Filter state has one lane per channel, coefficients are shared */
+	double w11[29][21][GEQ_CHANNELS], w12[29][21][GEQ_CHANNELS];
+	double w21[29][21][GEQ_CHANNELS], w22[29][21][GEQ_CHANNELS];
     // -------------------------------------------------------------------
 
 private:
-    float gain[29], gainold[29], master; //parameters
+    float gain[29], gainold[29], master, multirate, firmode; //parameters
+
+    /*
+     * Multirate mode runs the low bands on a copy decimated by mr_factor
+     * and adds back only the change they make, interpolated to the full
+     * rate, onto the input delayed by the same mr_taps - 1 frames.
+     */
+    int mr_factor, mr_taps, oldmultirate;
+    double mr_fir[MR_MAXTAPS];
+    double mr_hist[MR_RING][GEQ_CHANNELS], mr_diff[MR_DRING][GEQ_CHANNELS];
+    uint32_t mr_pos, mr_dpos, mr_phase;
+
+    /*
+     * FIR mode renders the whole curve as one filter designed in the
+     * background, so the cost no longer grows with the bands in use.
+     */
+    ZamGEQ31Curve curve;
+    ZamFIREQ<ZamGEQ31Curve> firmin, firlin;
+    int oldfir, oldwant, oldlatency;
 };
 
 // -----------------------------------------------------------------------
@@ -127,6 +127,15 @@ void ZamGatePlugin::initParameter(uint32_t index, Parameter& parameter)
 		parameter.ranges.min = -45.0f;
 		parameter.ranges.max = 20.0f;
 		break;
+	case paramDetect:
+		parameter.hints = kParameterIsAutomable | kParameterIsInteger;
+		parameter.name = "Detection (Peak/RMS/True Peak)";
+		parameter.symbol = "detect";
+		parameter.unit = " ";
+		parameter.ranges.def = 1.0f;
+		parameter.ranges.min = 0.0f;
+		parameter.ranges.max = 2.0f;
+		break;
 	}
 }
 
@@ -175,6 +184,9 @@ float ZamGatePlugin::getParameterValue(uint32_t index) const
 	case paramOutputLevel:
 		return outlevel;
 		break;
+	case paramDetect:
+		return detect;
+		break;
 	default:
 		return 0.0f;
 	}
@@ -211,6 +223,9 @@ void ZamGatePlugin::setParameterValue(uint32_t index, float value)
 	case paramOutputLevel:
 		outlevel = value;
 		break;
+	case paramDetect:
+		detect = value;
+		break;
 	}
 }
 
@@ -223,6 +238,7 @@ void ZamGatePlugin::loadProgram(uint32_t)
 	makeup = 0.0;
 	sidechain = 0.0;
 	openshut = 0.0;
+	detect = 1.0;
 	gateclose = -50.f;
 	outlevel = -45.0;
 	activate();
@@ -233,32 +249,9 @@ void ZamGatePlugin::loadProgram(uint32_t)
 
 void ZamGatePlugin::activate()
 {
-	int i;
 	gatestatel = 0.f;
-	posl = 0;
-	for (i = 0; i < MAX_GATE; i++) {
-		samplesl[i] = 0.f;
-	}
-}
-
-void ZamGatePlugin::pushsamplel(float samples[], float sample)
-{
-	++posl;
-	if (posl >= MAX_GATE)
-		posl = 0;
-	samples[posl] = sample;
-}
-
-float ZamGatePlugin::averageabs(float samples[])
-{
-	int i;
-	float average = 0.f;
-
-	for (i = 0; i < MAX_GATE; i++) {
-		average += samples[i]*samples[i];
-	}
-	average /= (float) MAX_GATE;
-	return sqrt(average);
+	detectorl.setWindow(MAX_GATE);
+	detectorl.reset();
 }
 
 void ZamGatePlugin::run(const float** inputs, float** outputs, uint32_t frames)
@@ -279,15 +272,12 @@ void ZamGatePlugin::run(const float** inputs, float** outputs, uint32_t frames)
 	float max = 0.f;
 	float mingate = (gateclose == -50.f) ? 0.f : from_dB(gateclose);
 
+	detectorl.setMode((int)detect);
+
 	for(i = 0; i < frames; i++) {
 		in0 = inputs[0][i];
 		side = inputs[1][i];
-		if (usesidechain) {
-			pushsamplel(samplesl, side);
-		} else {
-			pushsamplel(samplesl, in0);
-		}
-		absample = averageabs(samplesl);
+		absample = detectorl.process(usesidechain ? side : in0);
 		if (openshut < 0.5) {
 			if (absample > from_dB(thresdb)) {
 				gl += att;
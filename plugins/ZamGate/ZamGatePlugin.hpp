@@ -18,6 +18,7 @@
 
 #include "DistrhoPlugin.hpp"
 #include <algorithm>
+#include "../../dsp/ZamDetector.hpp"
 
 #define MAX_GATE 400
 
@@ -39,6 +40,7 @@ public:
 		paramOpenshut,
 		paramOutputLevel,
 		paramGainR,
+		paramDetect,
 		paramCount
 	};
 
@@ -119,14 +121,10 @@ protected:
 	}
 
 	// -------------------------------------------------------------------
-	float attack,release,thresdb,makeup,sidechain,gateclose,openshut,gainr,outlevel; //parameters
+	float attack,release,thresdb,makeup,sidechain,gateclose,openshut,gainr,outlevel,detect; //parameters
 
-	void pushsamplel(float samples[], float sample);
-	float averageabs(float samples[]);
-
-	float samplesl[MAX_GATE];
+	ZamDetector detectorl;
 	float gatestatel;
-	int posl;
 };
 
 // -----------------------------------------------------------------------
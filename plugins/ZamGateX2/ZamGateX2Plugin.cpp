@@ -127,6 +127,15 @@ void ZamGateX2Plugin::initParameter(uint32_t index, Parameter& parameter)
 		parameter.ranges.min = -45.0f;
 		parameter.ranges.max = 20.0f;
 		break;
+	case paramDetect:
+		parameter.hints = kParameterIsAutomable | kParameterIsInteger;
+		parameter.name = "Detection (Peak/RMS/True Peak)";
+		parameter.symbol = "detect";
+		parameter.unit = " ";
+		parameter.ranges.def = 1.0f;
+		parameter.ranges.min = 0.0f;
+		parameter.ranges.max = 2.0f;
+		break;
 	}
 }
 
@@ -175,6 +184,9 @@ float ZamGateX2Plugin::getParameterValue(uint32_t index) const
 	case paramOutputLevel:
 		return outlevel;
 		break;
+	case paramDetect:
+		return detect;
+		break;
 	default:
 		return 0.0f;
 	}
@@ -211,6 +223,9 @@ void ZamGateX2Plugin::setParameterValue(uint32_t index, float value)
 	case paramOutputLevel:
 		outlevel = value;
 		break;
+	case paramDetect:
+		detect = value;
+		break;
 	}
 }
 
@@ -225,6 +240,7 @@ void ZamGateX2Plugin::loadProgram(uint32_t)
 	gateclose = -50.0;
 	sidechain = 0.0;
 	openshut = 0.0;
+	detect = 1.0;
 
 	activate();
 }
@@ -234,42 +250,11 @@ void ZamGateX2Plugin::loadProgram(uint32_t)
 
 void ZamGateX2Plugin::activate()
 {
-	int i;
 	gatestate = 0.f;
-	posl = 0;
-	posr = 0;
-	for (i = 0; i < MAX_GATE; i++) {
-		samplesl[i] = 0.f;
-		samplesr[i] = 0.f;
-	}
-}
-
-void ZamGateX2Plugin::pushsamplel(float samples[], float sample)
-{
-	++posl;
-	if (posl >= MAX_GATE)
-		posl = 0;
-	samples[posl] = sample;
-}
-
-void ZamGateX2Plugin::pushsampler(float samples[], float sample)
-{
-	++posr;
-	if (posr >= MAX_GATE)
-		posr = 0;
-	samples[posr] = sample;
-}
-
-float ZamGateX2Plugin::averageabs(float samples[])
-{
-	int i;
-	float average = 0.f;
-
-	for (i = 0; i < MAX_GATE; i++) {
-		average += samples[i]*samples[i];
-	}
-	average /= (float) MAX_GATE;
-	return sqrt(average);
+	detectorl.setWindow(MAX_GATE);
+	detectorr.setWindow(MAX_GATE);
+	detectorl.reset();
+	detectorr.reset();
 }
 
 void ZamGateX2Plugin::run(const float** inputs, float** outputs, uint32_t frames)
@@ -292,18 +277,18 @@ void ZamGateX2Plugin::run(const float** inputs, float** outputs, uint32_t frames
 	float mingate = (gateclose == -50.f) ? 0.f : from_dB(gateclose);
 	max = 0.f;
 
+	detectorl.setMode((int)detect);
+	detectorr.setMode((int)detect);
+
 	for(i = 0; i < frames; i++) {
 		in0 = inputs[0][i];
 		in1 = inputs[1][i];
 		side = inputs[2][i];
 		if (usesidechain) {
-			pushsamplel(samplesl, side);
-			absample = averageabs(samplesl);
+			absample = detectorl.process(side);
 		} else {
-			pushsamplel(samplesl, in0);
-			pushsampler(samplesr, in1);
-			absamplel = averageabs(samplesl);
-			absampler = averageabs(samplesr);
+			absamplel = detectorl.process(in0);
+			absampler = detectorr.process(in1);
 			absample = std::max(absamplel, absampler);
 		}
 		if (openshut < 0.5) {
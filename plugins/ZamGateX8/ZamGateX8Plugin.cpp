@@ -0,0 +1,429 @@
+/*
+ * ZamGateX8 multichannel gate plugin
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the doc/GPL.txt file.
+ */
+
+#include "ZamGateX8Plugin.hpp"
+#include <string.h>
+
+START_NAMESPACE_DISTRHO
+
+// -----------------------------------------------------------------------
+
+ZamGateX8Plugin::ZamGateX8Plugin()
+	: Plugin(paramCount, 1, 0) // 1 program, 0 states
+{
+	// set default values
+	loadProgram(0);
+}
+
+// -----------------------------------------------------------------------
+// Init
+
+void ZamGateX8Plugin::initProgramName(uint32_t index, String& programName)
+{
+	if (index != 0)
+		return;
+
+	programName = "Default";
+}
+
+// -----------------------------------------------------------------------
+// Internal data
+
+void ZamGateX8Plugin::initParameter(uint32_t index, Parameter& parameter)
+{
+	switch (index)
+	{
+	case paramAttack:
+		parameter.hints = kParameterIsAutomable;
+		parameter.name = "Attack";
+		parameter.symbol = "att";
+		parameter.unit = "ms";
+		parameter.ranges.def = 50.0f;
+		parameter.ranges.min = 0.1f;
+		parameter.ranges.max = 500.0f;
+		break;
+	case paramRelease:
+		parameter.hints = kParameterIsAutomable;
+		parameter.name = "Release";
+		parameter.symbol = "rel";
+		parameter.unit = "ms";
+		parameter.ranges.def = 100.0f;
+		parameter.ranges.min = 0.1f;
+		parameter.ranges.max = 500.0f;
+		break;
+	case paramThresh:
+		parameter.hints = kParameterIsAutomable;
+		parameter.name = "Threshold";
+		parameter.symbol = "thr";
+		parameter.unit = "dB";
+		parameter.ranges.def = -60.0f;
+		parameter.ranges.min = -60.0f;
+		parameter.ranges.max = 0.0f;
+		break;
+	case paramMakeup:
+		parameter.hints = kParameterIsAutomable;
+		parameter.name = "Makeup";
+		parameter.symbol = "mak";
+		parameter.unit = "dB";
+		parameter.ranges.def = 0.0f;
+		parameter.ranges.min = -30.0f;
+		parameter.ranges.max = 30.0f;
+		break;
+	case paramGateclose:
+		parameter.hints = kParameterIsAutomable;
+		parameter.name = "Max gate close";
+		parameter.symbol = "close";
+		parameter.unit = "dB";
+		parameter.ranges.def = -50.0f;
+		parameter.ranges.min = -50.0f;
+		parameter.ranges.max = 0.0f;
+		break;
+	case paramSidechain:
+		parameter.hints = kParameterIsAutomable | kParameterIsBoolean;
+		parameter.name = "Sidechain";
+		parameter.symbol = "sidechain";
+		parameter.unit = " ";
+		parameter.ranges.def = 0.0f;
+		parameter.ranges.min = 0.0f;
+		parameter.ranges.max = 1.0f;
+		break;
+	case paramOpenshut:
+		parameter.hints = kParameterIsAutomable | kParameterIsBoolean;
+		parameter.name = "Mode open/shut";
+		parameter.symbol = "mode";
+		parameter.unit = " ";
+		parameter.ranges.def = 0.0f;
+		parameter.ranges.min = 0.0f;
+		parameter.ranges.max = 1.0f;
+		break;
+	case paramDetect:
+		parameter.hints = kParameterIsAutomable | kParameterIsInteger;
+		parameter.name = "Detection (Peak/RMS/True Peak)";
+		parameter.symbol = "detect";
+		parameter.unit = " ";
+		parameter.ranges.def = 1.0f;
+		parameter.ranges.min = 0.0f;
+		parameter.ranges.max = 2.0f;
+		break;
+	case paramLink:
+		parameter.hints = kParameterIsAutomable | kParameterIsInteger;
+		parameter.name = "Link (Average/Max/Per-channel)";
+		parameter.symbol = "link";
+		parameter.unit = " ";
+		parameter.ranges.def = 1.0f;
+		parameter.ranges.min = 0.0f;
+		parameter.ranges.max = 2.0f;
+		break;
+	case paramChannels:
+		parameter.hints = kParameterIsAutomable | kParameterIsInteger;
+		parameter.name = "Channels";
+		parameter.symbol = "channels";
+		parameter.unit = " ";
+		parameter.ranges.def = MAX_CHANNELS;
+		parameter.ranges.min = 1.0f;
+		parameter.ranges.max = MAX_CHANNELS;
+		break;
+	case paramGainR:
+		parameter.hints = kParameterIsOutput;
+		parameter.name = "Gain Reduction";
+		parameter.symbol = "gainr";
+		parameter.unit = "dB";
+		parameter.ranges.def = 0.0f;
+		parameter.ranges.min = 0.0f;
+		parameter.ranges.max = 40.0f;
+		break;
+	case paramOutputLevel:
+		parameter.hints = kParameterIsOutput;
+		parameter.name = "Output Level";
+		parameter.symbol = "outlevel";
+		parameter.unit = "dB";
+		parameter.ranges.def = -45.0f;
+		parameter.ranges.min = -45.0f;
+		parameter.ranges.max = 20.0f;
+		break;
+	}
+}
+
+void ZamGateX8Plugin::initAudioPort(bool input, uint32_t index, AudioPort& port)
+{
+	Plugin::initAudioPort(input, index, port);
+
+	if ((index == MAX_CHANNELS) && input) {
+		port.hints |= kAudioPortIsSidechain;
+		port.name = "Sidechain Input";
+		port.symbol = "sidechain_in";
+	}
+}
+
+// -----------------------------------------------------------------------
+// Internal data
+
+float ZamGateX8Plugin::getParameterValue(uint32_t index) const
+{
+	switch (index)
+	{
+	case paramAttack:
+		return attack;
+		break;
+	case paramRelease:
+		return release;
+		break;
+	case paramThresh:
+		return thresdb;
+		break;
+	case paramMakeup:
+		return makeup;
+		break;
+	case paramGateclose:
+		return gateclose;
+		break;
+	case paramSidechain:
+		return sidechain;
+		break;
+	case paramOpenshut:
+		return openshut;
+		break;
+	case paramDetect:
+		return detect;
+		break;
+	case paramLink:
+		return link;
+		break;
+	case paramChannels:
+		return channels;
+		break;
+	case paramGainR:
+		return gainr;
+		break;
+	case paramOutputLevel:
+		return outlevel;
+		break;
+	default:
+		return 0.0f;
+	}
+}
+
+void ZamGateX8Plugin::setParameterValue(uint32_t index, float value)
+{
+	switch (index)
+	{
+	case paramAttack:
+		attack = value;
+		break;
+	case paramRelease:
+		release = value;
+		break;
+	case paramThresh:
+		thresdb = value;
+		break;
+	case paramMakeup:
+		makeup = value;
+		break;
+	case paramGateclose:
+		gateclose = value;
+		break;
+	case paramSidechain:
+		sidechain = value;
+		break;
+	case paramOpenshut:
+		openshut = value;
+		break;
+	case paramDetect:
+		detect = value;
+		break;
+	case paramLink:
+		link = value;
+		break;
+	case paramChannels:
+		channels = value;
+		break;
+	case paramGainR:
+		gainr = value;
+		break;
+	case paramOutputLevel:
+		outlevel = value;
+		break;
+	}
+}
+
+void ZamGateX8Plugin::loadProgram(uint32_t)
+{
+	attack = 50.0;
+	release = 100.0;
+	thresdb = -60.0;
+	gainr = 0.0;
+	makeup = 0.0;
+	outlevel = -45.0;
+	gateclose = -50.0;
+	sidechain = 0.0;
+	openshut = 0.0;
+	detect = 1.0;
+	link = LINK_MAX;
+	channels = MAX_CHANNELS;
+
+	activate();
+}
+
+// -----------------------------------------------------------------------
+// Process
+
+void ZamGateX8Plugin::activate()
+{
+	int c;
+
+	for (c = 0; c < MAX_CHANNELS; c++) {
+		gatestate[c] = 0.f;
+		detector[c].setWindow(MAX_GATE);
+		detector[c].reset();
+	}
+	onedetector = false;
+}
+
+/*
+ * Linked and sidechained channels share one gate, so its state is updated
+ * once per sample and only the gain runs on every channel. The sliding
+ * maximum of the loudest channel is the loudest sliding maximum, so max
+ * linked peak detection needs just one detector too. Past the detectors
+ * each step is a plain loop across the channel arrays.
+ */
+void ZamGateX8Plugin::run(const float** inputs, float** outputs, uint32_t frames)
+{
+	uint32_t i;
+	int c;
+	float att;
+	float rel;
+	float g;
+	float fs;
+	float lvl;
+	float out;
+	float max;
+	fs = getSampleRate();
+	att = 1000.f / (attack * fs);
+	rel = 1000.f / (release * fs);
+	bool usesidechain = (sidechain < 0.5) ? false : true;
+	float mingate = (gateclose == -50.f) ? 0.f : from_dB(gateclose);
+	float thres = from_dB(thresdb);
+	float makeupgain = from_dB(makeup);
+	int linkmode = (int)link;
+	int nch = (int)channels;
+	bool shared = usesidechain || linkmode != LINK_UNCOUPLED;
+	bool single = !usesidechain && linkmode == LINK_MAX && (int)detect == ZamDetector::DETECT_PEAK;
+	max = 0.f;
+
+	if (nch < 1)
+		nch = 1;
+	if (nch > MAX_CHANNELS)
+		nch = MAX_CHANNELS;
+
+	// Channels beyond the active count pass through untouched
+	for (c = nch; c < MAX_CHANNELS; c++) {
+		if (outputs[c] != inputs[c])
+			memcpy(outputs[c], inputs[c], frames * sizeof(float));
+	}
+
+	for (c = 0; c < nch; c++)
+		detector[c].setMode((int)detect);
+
+	// The detectors that were left idle hold stale history
+	if (single != onedetector) {
+		for (c = 0; c < MAX_CHANNELS; c++)
+			detector[c].reset();
+		onedetector = single;
+	}
+
+	if (!shared) {
+		for(i = 0; i < frames; i++) {
+			for (c = 0; c < nch; c++)
+				level[c] = detector[c].process(inputs[c][i]);
+
+			if (openshut < 0.5) {
+				for (c = 0; c < nch; c++) {
+					g = gatestate[c];
+					gatestate[c] = (level[c] > thres) ? fminf(g + att, 1.f) : fmaxf(g - rel, mingate);
+				}
+			} else {
+				for (c = 0; c < nch; c++) {
+					g = gatestate[c];
+					gatestate[c] = (level[c] > thres) ? fmaxf(g - att, mingate) : fminf(g + rel, 1.f);
+				}
+			}
+
+			for (c = 0; c < nch; c++) {
+				out = gatestate[c] * makeupgain * inputs[c][i];
+				outputs[c][i] = out;
+				max = fmaxf(max, fabsf(out));
+			}
+		}
+	} else {
+		for(i = 0; i < frames; i++) {
+			if (usesidechain) {
+				lvl = detector[0].process(inputs[MAX_CHANNELS][i]);
+			} else if (single) {
+				lvl = fabsf(inputs[0][i]);
+				for (c = 1; c < nch; c++)
+					lvl = fmaxf(lvl, fabsf(inputs[c][i]));
+				lvl = detector[0].process(lvl);
+			} else {
+				for (c = 0; c < nch; c++)
+					level[c] = detector[c].process(inputs[c][i]);
+				lvl = level[0];
+				if (linkmode == LINK_MAX) {
+					for (c = 1; c < nch; c++)
+						lvl = std::max(lvl, level[c]);
+				} else {
+					for (c = 1; c < nch; c++)
+						lvl += level[c];
+					lvl /= nch;
+				}
+			}
+
+			g = gatestate[0];
+			if (openshut < 0.5)
+				gatestate[0] = (lvl > thres) ? fminf(g + att, 1.f) : fmaxf(g - rel, mingate);
+			else
+				gatestate[0] = (lvl > thres) ? fmaxf(g - att, mingate) : fminf(g + rel, 1.f);
+
+			g = gatestate[0] * makeupgain;
+			for (c = 0; c < nch; c++) {
+				out = g * inputs[c][i];
+				outputs[c][i] = out;
+				max = fmaxf(max, fabsf(out));
+			}
+		}
+
+		// Hand the shared gate to every channel in case they uncouple
+		for (c = 1; c < nch; c++)
+			gatestate[c] = gatestate[0];
+	}
+
+	g = gatestate[0];
+	for (c = 1; c < nch; c++)
+		g = fminf(g, gatestate[c]);
+	gainr = (g > 0) ? sanitize_denormal(-to_dB(g)) : 45.0;
+	outlevel = (max == 0.f) ? -45.f : to_dB(max);
+}
+
+// -----------------------------------------------------------------------
+
+Plugin* createPlugin()
+{
+	return new ZamGateX8Plugin();
+}
+
+// -----------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
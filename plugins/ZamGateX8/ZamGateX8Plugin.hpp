@@ -0,0 +1,145 @@
+/*
+ * ZamGateX8 multichannel gate
+ * Copyright (C) 2026  Damien Zammit <damien@zamaudio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef ZAMGATEX8PLUGIN_HPP_INCLUDED
+#define ZAMGATEX8PLUGIN_HPP_INCLUDED
+
+#include "DistrhoPlugin.hpp"
+#include <algorithm>
+#include "../../dsp/ZamDetector.hpp"
+
+#define MAX_GATE 400
+
+#define LINK_AVERAGE 0
+#define LINK_MAX 1
+#define LINK_UNCOUPLED 2
+
+#define MAX_CHANNELS DISTRHO_PLUGIN_NUM_OUTPUTS
+
+START_NAMESPACE_DISTRHO
+
+// -----------------------------------------------------------------------
+
+class ZamGateX8Plugin : public Plugin
+{
+public:
+	enum Parameters
+	{
+		paramAttack,
+		paramRelease,
+		paramThresh,
+		paramMakeup,
+		paramSidechain,
+		paramGateclose,
+		paramOpenshut,
+		paramDetect,
+		paramLink,
+		paramChannels,
+		paramOutputLevel,
+		paramGainR,
+		paramCount
+	};
+
+	ZamGateX8Plugin();
+
+protected:
+	// -------------------------------------------------------------------
+	// Information
+
+	const char* getLabel() const noexcept override
+	{
+		return "ZamGateX8";
+	}
+
+	const char* getDescription() const noexcept override
+	{
+	    return "Gate plugin for ducking low gain sounds, linked version for up to eight channels.";
+	}
+
+	const char* getMaker() const noexcept override
+	{
+		return "Damien Zammit";
+	}
+
+	const char* getHomePage() const noexcept override
+	{
+	    return "http://www.zamaudio.com";
+	}
+
+	const char* getLicense() const noexcept override
+	{
+		return "GPL v2+";
+	}
+
+	uint32_t getVersion() const noexcept override
+	{
+		return d_version(3, 12, 0);
+	}
+
+	int64_t getUniqueId() const noexcept override
+	{
+		return d_cconst('Z', 'G', 'T', '8');
+	}
+
+	// -------------------------------------------------------------------
+	// Init
+
+	void initParameter(uint32_t index, Parameter& parameter) override;
+	void initProgramName(uint32_t index, String& programName) override;
+	void initAudioPort(bool input, uint32_t index, AudioPort& port) override;
+
+	// -------------------------------------------------------------------
+	// Internal data
+
+	float getParameterValue(uint32_t index) const override;
+	void  setParameterValue(uint32_t index, float value) override;
+	void  loadProgram(uint32_t index) override;
+
+	// -------------------------------------------------------------------
+	void activate() override;
+	void run(const float** inputs, float** outputs, uint32_t frames) override;
+
+	static inline float
+	sanitize_denormal(float v) {
+		if(!std::isnormal(v) || !std::isfinite(v))
+			return 0.f;
+		return v;
+	}
+
+	static inline float
+	from_dB(float gdb) {
+		return (exp(gdb/20.f*log(10.f)));
+	}
+
+	static inline float
+	to_dB(float g) {
+		return (20.f*log10(g));
+	}
+
+	// -------------------------------------------------------------------
+	float attack,release,thresdb,makeup,gateclose,sidechain,openshut,gainr,outlevel,detect,link,channels; //parameters
+
+	/* Per channel state kept as flat arrays across the channels */
+	float level[MAX_CHANNELS];
+	float gatestate[MAX_CHANNELS];
+	ZamDetector detector[MAX_CHANNELS];
+	bool onedetector;	// max linked peak detection runs on detector[0] alone
+};
+
+// -----------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif
@@ -110,60 +110,29 @@ void ZamPhonoPlugin::setParameterValue(uint32_t index, float value)
 // -----------------------------------------------------------------------
 // Process
 
-void ZamPhonoPlugin::brickwall(float fc, float srate)
-{
-	float w0, alpha, cw, sw, q;
-	q = 0.707;
-	w0 = (2. * M_PI * fc / srate);
-	sw = sin(w0);
-	cw = cos(w0);
-	alpha = sw / (2. * q);
-
-	A0 = 1. + alpha;
-	A1 = -2. * cw;
-	A2 = 1. - alpha;
-	B0 = (1. - cw) / 2.;
-	B1 = (1. - cw);
-	B2 = B0;
-}
-
-void ZamPhonoPlugin::clearbrickwall(void)
-{
-	state[0] = state[1] = state[2] = state[3] = 0.0;
-}
-
 void ZamPhonoPlugin::activate()
 {
 	float srate = getSampleRate();
+	int t;
 
 	typeold = -1.f;
 	invold = -1.f;
 
-	zn1 = zn2 = zd1 = zd2 = 0.0;
-	clearbrickwall();
-	brickwall(std::min(0.45 * srate, 21000.), srate);
-}
-
-double ZamPhonoPlugin::run_brickwall(double in)
-{
-	double out;
-	in = sanitize_denormal(in);
-
-	out = B0/A0*in + B1/A0*state[0] + B2/A0*state[1]
-			-A1/A0*state[2] - A2/A0*state[3] + 1e-20;
+	for (t = 0; t < PHONO_TYPES; t++) {
+		emphasis(t, 0, srate, curves[0][t]);
+		emphasis(t, 1, srate, curves[1][t]);
+	}
 
-	state[1] = state[0];
-	state[0] = in;
-	state[3] = state[2];
-	state[2] = sanitize_denormal(out);
-	return state[2];
+	filter.reset();
+	filter.setLowpass(SEC_BRICKWALL, std::min(0.45 * srate, 21000.), srate, 0.707);
 }
 
-void ZamPhonoPlugin::emphasis(float srate)
+void ZamPhonoPlugin::emphasis(int curve, int production, float srate, double c[5])
 {
 	float t,i,j,k,g,tau1,tau2,tau3,freq;
+	double b0, b1, b2, a1, a2;
 
-	switch((int)type) {
+	switch(curve) {
 	case 0: //"Columbia"
 		i = 100.f;
 		j = 500.f;
@@ -205,7 +174,7 @@ void ZamPhonoPlugin::emphasis(float srate)
 	j *= 2.f * M_PI;
 	k *= 2.f * M_PI;
 
-	if (inv < 0.5) {
+	if (!production) {
 		//Reproduction
 		g = 1.f / (4.f+2.f*i*t+2.f*k*t+i*k*t*t);
 		b0 = (2.f*t+j*t*t)*g;
@@ -226,30 +195,15 @@ void ZamPhonoPlugin::emphasis(float srate)
 	freq = 1000.0 * 2.0 * M_PI / srate;
 	std::complex<double> z = 1.0 / exp(std::complex<double>(0.0, freq));
 	g = std::abs((std::complex<double>(b0) + double(b1) * z + double(b2) * z*z) / (std::complex<double>(1.0) + double(a1) * z + double(a2) * z*z));
-	b0 /= g;
-	b1 /= g;
-	b2 /= g;
-}
-
-double ZamPhonoPlugin::run_filter(double in)
-{
-	double out;
-
-	in = sanitize_denormal(in);
-	out = in * b0 + zn1 * b1 + zn2 * b2
-		      - zd1 * a1 - zd2 * a2;
-	out = sanitize_denormal(out);
-	zn2 = sanitize_denormal(zn1);
-	zd2 = sanitize_denormal(zd1);
-	zn1 = in;
-	zd1 = out;
-
-	return out;
+	c[0] = b0 / g;
+	c[1] = b1 / g;
+	c[2] = b2 / g;
+	c[3] = a1;
+	c[4] = a2;
 }
 
 void ZamPhonoPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
-	float srate = getSampleRate();
 	int recalc = 0;
 
 	if (type != typeold) {
@@ -263,24 +217,17 @@ void ZamPhonoPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 	// Settings changed
 	if (recalc) {
 		// Clear filter states
-		zn1 = zn2 = zd1 = zd2 = 0.0;
-		clearbrickwall();
-
-		// Recalculate filter coeffs
-		brickwall(std::min(0.45 * srate, 21000.), srate);
-		emphasis(srate);
+		filter.reset();
+
+		// Switch to the curve designed in activate(), out of range is RIAA
+		int t = (int)type;
+		if (t < 0 || t >= PHONO_TYPES)
+			t = 3;
+		const double *c = curves[inv < 0.5 ? 0 : 1][t];
+		filter.setSection(SEC_EMPHASIS, c[0], c[1], c[2], 1., c[3], c[4]);
 	}
 
-	double tmp;
-	double in;
-
-	for (uint32_t i = 0; i < frames; i++) {
-		in = inputs[0][i];
-		tmp = run_filter(in);
-		tmp = run_brickwall(tmp);
-		outputs[0][i] = in;
-		outputs[0][i] = (float)tmp;
-	}
+	filter.process(inputs, outputs, frames);
 
 	typeold = type;
 	invold = inv;
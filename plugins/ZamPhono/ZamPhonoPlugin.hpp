@@ -18,6 +18,12 @@
 
 #include "DistrhoPlugin.hpp"
 #include <complex>
+#include "../../dsp/ZamBiquad.hpp"
+
+/* ZamPhonoX2 builds this same plugin in stereo */
+#define PHONO_CHANNELS DISTRHO_PLUGIN_NUM_OUTPUTS
+
+#define PHONO_TYPES 5
 
 START_NAMESPACE_DISTRHO
 
@@ -41,7 +47,7 @@ protected:
 
     const char* getLabel() const noexcept override
     {
-        return "ZamPhono";
+        return DISTRHO_PLUGIN_NAME;
     }
 
     const char* getMaker() const noexcept override
@@ -61,7 +67,11 @@ protected:
 
     int64_t getUniqueId() const noexcept override
     {
+#if PHONO_CHANNELS == 1
         return d_cconst('Z', 'M', 'P', 'H');
+#else
+        return d_cconst('Z', 'P', 'H', '0' + PHONO_CHANNELS);
+#endif
     }
 
     // -------------------------------------------------------------------
@@ -100,17 +110,18 @@ protected:
 
     void activate() override;
     void run(const float** inputs, float** outputs, uint32_t frames) override;
-    void emphasis(float srate);
-    double run_filter(double in);
-    void brickwall(float fc, float srate);
-    void clearbrickwall(void);
-    double run_brickwall(double in);
-
-        double zn1, zn2, zd1, zd2;
-        double b0, b1, b2;
-        double a1, a2;
-    double state[4];
-    double A0, A1, A2, B0, B1, B2;
+    void emphasis(int curve, int production, float srate, double c[5]);
+
+    /*
+     * Emphasis b0 b1 b2 a1 a2 of every type, for reproduction and for
+     * production, designed for the current rate in activate() so a
+     * change of curve only copies coefficients.
+     */
+    double curves[2][PHONO_TYPES][5];
+
+    /* De-emphasis curve, then a lowpass below nyquist, on every channel */
+    enum { SEC_EMPHASIS = 0, SEC_BRICKWALL, SECTIONS };
+    ZamBiquadCascade<double, PHONO_CHANNELS, SECTIONS> filter;
 
     // -------------------------------------------------------------------
 